@@ -0,0 +1,63 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include "bench.hh"
+
+#include <syard/ast.hh>
+#include <memory>
+#include <string.h>
+#include <vector>
+
+using namespace std;
+using namespace syard;
+
+// i.e. what consumers did before: a tree of heap allocated nodes,
+// rebuilt from the RPN callbacks
+struct Heap_Node {
+  uint8_t id;
+  string text;
+  vector<unique_ptr<Heap_Node> > args;
+};
+
+BENCH_CASE(ast_build)
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.function_table().insert("max", 20);
+  for (auto s : { "price", "qty", "fee" })
+    p.symbol_table().insert(s);
+  const char *s = "max(price * 2, qty) - fee / 2.5 + (price - 1) * qty";
+  auto e = s + strlen(s);
+  Ast a;
+  p.parse_ast(s, e, a);
+  size_t n = a.size();
+
+  Stack<string> o;
+  vector<unique_ptr<Heap_Node> > stack;
+  bench::measure("heap nodes", 100000, n, [&] {
+      p.parse(s, e, o, [&](uint8_t id) {
+          // an empty string marks a subtree on the node stack, the
+          // default arithmetic operators are binary
+          unique_ptr<Heap_Node> x(new Heap_Node{id, string(), {}});
+          x->args.resize(2);
+          for (unsigned i = 2; i-- > 0; ) {
+            if (o.top().empty()) {
+              x->args[i] = std::move(stack.back());
+              stack.pop_back();
+            } else {
+              x->args[i].reset(new Heap_Node{OPERAND, o.top(), {}});
+            }
+            o.pop();
+          }
+          stack.push_back(std::move(x));
+          o.push(string());
+          });
+      bench::keep(stack);
+      stack.clear();
+      while (!o.empty())
+        o.pop();
+      });
+  bench::measure("arena", 100000, n, [&] {
+      p.parse_ast(s, e, a);
+      bench::keep(a.root());
+      });
+}
@@ -0,0 +1,41 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include "bench.hh"
+
+#include <syard/batch.hh>
+#include <vector>
+
+using namespace std;
+using namespace syard;
+
+// price * qty - fee over 1M rows
+BENCH_CASE(batch_columns)
+{
+  size_t n = 1 << 20;
+  vector<double> price(n), qty(n), fee(n), out(n);
+  for (size_t i = 0; i < n; ++i) {
+    price[i] = i * 0.5;
+    qty[i] = i % 10;
+    fee[i] = 1.25;
+  }
+  Parser parser;
+  parser.operator_table().insert_default_arithmetic();
+  for (auto s : { "price", "qty", "fee" })
+    parser.symbol_table().insert(s);
+  auto p = parser.compile<double>("price * qty - fee");
+
+  Evaluator<double> e;
+  bench::measure("row at a time", 10, n, [&] {
+      for (size_t i = 0; i < n; ++i) {
+        double vars[] = { price[i], qty[i], fee[i] };
+        out[i] = e.run(p, vars);
+      }
+      bench::keep(out[0]);
+      });
+  Batch_Evaluator<double> b;
+  const double *columns[] = { price.data(), qty.data(), fee.data() };
+  bench::measure("vector at a time", 10, n, [&] {
+      b.run(p, columns, out.data(), n);
+      bench::keep(out[0]);
+      });
+}
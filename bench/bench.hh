@@ -0,0 +1,69 @@
+#ifndef SYARD_BENCH_BENCH_HH
+#define SYARD_BENCH_BENCH_HH
+
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include <atomic>
+#include <chrono>
+#include <stddef.h>
+#include <stdio.h>
+
+namespace bench {
+
+  // calls of operator new, counted by main.cc
+  extern std::atomic<size_t> allocations;
+  // bytes allocated via operator new and not deleted yet, and their
+  // maximum since the last reset, i.e. by measure()
+  extern std::atomic<size_t> live_bytes;
+  extern std::atomic<size_t> peak_bytes;
+
+  // prevents the compiler from optimizing v away
+  template <typename T> inline void keep(T &&v)
+  {
+    asm volatile("" : : "g"(&v) : "memory");
+  }
+
+  // runs f() n times and prints the time per call (and per op if a call
+  // consists of ops many operations, e.g. tokens or emitted operators)
+  // and the heap allocations per call, plus the peak of the heap
+  // (above what was live before) of the case
+  template <typename F>
+    double measure(const char *name, size_t n, size_t ops, F f)
+    {
+      size_t base = live_bytes;
+      peak_bytes = base;
+      for (size_t i = 0; i < n / 10 + 1; ++i)
+        f();
+      size_t allocs = allocations;
+      auto start = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < n; ++i)
+        f();
+      auto stop = std::chrono::steady_clock::now();
+      double a = double(allocations - allocs) / n;
+      double ns = std::chrono::duration<double, std::nano>(
+          stop - start).count() / n;
+      double peak = double(peak_bytes - base) / 1024;
+      if (ops)
+        printf("%-40s %10.1f ns/call %8.2f ns/op %8.2f allocs/call"
+            " %10.1f KiB peak\n", name, ns, ns / ops, a, peak);
+      else
+        printf("%-40s %10.1f ns/call %17s %8.2f allocs/call"
+            " %10.1f KiB peak\n", name, ns, "", a, peak);
+      return ns;
+    }
+
+  struct Case {
+    const char *name;
+    void (*fn)();
+    Case *next;
+    Case(const char *name, void (*fn)());
+  };
+
+} // bench
+
+#define BENCH_CASE(NAME) \
+  static void NAME(); \
+  static bench::Case NAME ## _case(#NAME, NAME); \
+  static void NAME()
+
+#endif // SYARD_BENCH_BENCH_HH
@@ -0,0 +1,35 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include "bench.hh"
+
+#include <syard/cache.hh>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace syard;
+
+// 1000 distinct formulas that recur, compiled each time vs. cached
+BENCH_CASE(cache_get)
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.function_table().insert("max", 20);
+  for (auto s : { "price", "qty", "fee" })
+    p.symbol_table().insert(s);
+  vector<string> v;
+  for (unsigned i = 0; i < 1000; ++i)
+    v.push_back("max(price * " + to_string(i) + ", qty) - fee / 2.5");
+  bench::measure("compile", 100, v.size(), [&] {
+      for (auto &s : v)
+        bench::keep(p.compile<double>(s.c_str()));
+      });
+  Program_Cache<double> c(1 << 20);
+  bench::measure("cache", 100, v.size(), [&] {
+      for (auto &s : v)
+        bench::keep(c.get(p, s.c_str()));
+      });
+  auto st = c.stats();
+  printf("hits %zu misses %zu evictions %zu entries %zu bytes %zu\n",
+      st.hits, st.misses, st.evictions, st.entries, st.bytes);
+}
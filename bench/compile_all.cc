@@ -0,0 +1,36 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include "bench.hh"
+
+#include <syard/compile_all.hh>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace syard;
+
+// 100k formulas, with 1 thread up to hardware concurrency
+BENCH_CASE(compile_all)
+{
+  auto g = make_shared<Grammar>();
+  g->operator_table().insert_default_arithmetic();
+  g->function_table().insert("max", 20);
+  for (auto s : { "price", "qty", "fee" })
+    g->symbol_table().insert(s);
+  g->freeze();
+  vector<string> v;
+  for (unsigned i = 0; i < 100000; ++i)
+    v.push_back("max(price * " + to_string(i % 97) + ", qty) - fee / "
+        + to_string(i % 13 + 1) + ".5");
+  unsigned m = max(1u, thread::hardware_concurrency());
+  for (unsigned t = 1; ; t = min(t * 2, m)) {
+    string name = "threads " + to_string(t);
+    bench::measure(name.c_str(), 5, v.size(), [&] {
+        bench::keep(compile_all<double>(g, v, t));
+        });
+    if (t == m)
+      break;
+  }
+}
@@ -0,0 +1,85 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include "bench.hh"
+#include "corpus.hh"
+
+#include <syard/program.hh>
+#include <syard/syard.hh>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace syard;
+
+static Parser make_parser()
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  bench::insert_multibyte(p.operator_table());
+  bench::insert_functions(p);
+  // i.e. the const lookups don't sort lazily
+  p.operator_table().sort();
+  p.function_table().freeze();
+  // i.e. each corpus is well-formed, as parse() with an id-only
+  // callback doesn't consume the operands
+  for (auto &c : bench::corpora())
+    p.compile<double>(c.text.c_str());
+  return p;
+}
+
+static size_t count_tokens(const Operator_Table &t, const string &s)
+{
+  size_t n = 0;
+  auto e = s.data() + s.size();
+  for (auto r = t.lex(s.data(), e); r.id != EPSILON; r = t.lex(r.p.second, e))
+    ++n;
+  return n;
+}
+
+BENCH_CASE(corpus_lex)
+{
+  auto p = make_parser();
+  auto &t = p.grammar().operator_table();
+  for (auto &c : bench::corpora()) {
+    size_t n = count_tokens(t, c.text);
+    auto e = c.text.data() + c.text.size();
+    bench::measure(c.name, 1000, n, [&] {
+        for (auto r = t.lex(c.text.data(), e); r.id != EPSILON;
+            r = t.lex(r.p.second, e))
+          bench::keep(r);
+        });
+  }
+}
+
+BENCH_CASE(corpus_function_at)
+{
+  auto p = make_parser();
+  auto &t = p.grammar().function_table();
+  vector<string> names;
+  for (unsigned i = 0; i < 64; ++i)
+    names.push_back(bench::function_name(i * 13));
+  bench::measure("hits", 10000, names.size(), [&] {
+      for (auto &s : names)
+        bench::keep(t.at(make_pair(s.data(), s.data() + s.size())));
+      });
+  names.assign(64, "nofunc");
+  bench::measure("misses (find)", 10000, names.size(), [&] {
+      for (auto &s : names)
+        bench::keep(t.find(make_pair(s.data(), s.data() + s.size())));
+      });
+}
+
+BENCH_CASE(corpus_parse)
+{
+  auto p = make_parser();
+  auto &o = p.arg_stack();
+  for (auto &c : bench::corpora()) {
+    size_t n = count_tokens(p.grammar().operator_table(), c.text);
+    auto e = c.text.data() + c.text.size();
+    bench::measure(c.name, 1000, n, [&] {
+        p.parse(c.text.data(), e, [](uint8_t id) { bench::keep(id); });
+        while (!o.empty())
+          o.pop();
+        });
+  }
+}
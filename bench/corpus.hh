@@ -0,0 +1,114 @@
+#ifndef SYARD_BENCH_CORPUS_HH
+#define SYARD_BENCH_CORPUS_HH
+
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include <syard/syard.hh>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+  // synthetic expressions that stress different parts of the parser
+  struct Corpus {
+    const char *name;
+    std::string text;
+  };
+
+  // ((((1+2)*3)+4)*...)
+  inline std::string deep_nesting(unsigned depth)
+  {
+    std::string r(depth, '(');
+    r += "1";
+    for (unsigned i = 0; i < depth; ++i)
+      r += (i % 2 ? "*" : "+") + std::to_string(i % 10 + 2) + ")";
+    return r;
+  }
+  // 1+2*3-4/5+...
+  inline std::string long_chain(unsigned n)
+  {
+    static const char ops[] = "+*-/";
+    std::string r = "1";
+    for (unsigned i = 0; i < n; ++i) {
+      r += ops[i % 4];
+      r += std::to_string(i % 97 + 1);
+    }
+    return r;
+  }
+  // i.e. names consist of [a-z_]
+  inline std::string function_name(unsigned i)
+  {
+    return std::string("f") + char('a' + i / 8 % 8) + char('a' + i % 8);
+  }
+  // fbe(fad(1, 2), 3) + ..., cf. insert_functions()
+  inline std::string many_functions(unsigned n)
+  {
+    std::string r;
+    for (unsigned i = 0; i < n; ++i) {
+      if (i)
+        r += " + ";
+      r += function_name(i * 7) + "(" + function_name(i) + "(1, 2), "
+        + std::to_string(i) + ")";
+    }
+    return r;
+  }
+  // 1 ≤ 2 ≠ 3 − 4 <=> 5 ** 6, cf. insert_multibyte()
+  inline std::string multibyte(unsigned n)
+  {
+    static const char * const ops[] = {
+      " \xe2\x89\xa4 ", " \xe2\x89\xa0 ", " \xe2\x88\x92 ", " <=> ", " ** "
+    };
+    std::string r = "1";
+    for (unsigned i = 0; i < n; ++i)
+      r += ops[i % 5] + std::to_string(i % 10);
+    return r;
+  }
+  // -2*-3*--4*- - -5*...
+  inline std::string signs(unsigned n)
+  {
+    static const char * const s[] = { "-", "--", "- - -", "- -" };
+    std::string r = "-2";
+    for (unsigned i = 0; i < n; ++i)
+      r += std::string("*") + s[i % 4] + std::to_string(i % 9 + 1);
+    return r;
+  }
+  // -(1+1)*--(2+2)*- -(3+3)*... i.e. NEGATE instructions
+  inline std::string negated_groups(unsigned n)
+  {
+    static const char * const s[] = { "-", "--", "- -" };
+    std::string r = "-(1+1)";
+    for (unsigned i = 0; i < n; ++i) {
+      auto x = std::to_string(i % 9 + 1);
+      r += std::string("*") + s[i % 3] + "(" + x + "+" + x + ")";
+    }
+    return r;
+  }
+
+  inline void insert_functions(syard::Parser &p)
+  {
+    for (unsigned i = 0; i < 64; ++i)
+      p.function_table().insert(function_name(i).c_str(), 20 + i);
+  }
+  inline void insert_multibyte(syard::Operator_Table &t)
+  {
+    t.insert("\xe2\x89\xa4", 100, 5, true); // U+2264 less-than or equal to
+    t.insert("\xe2\x89\xa0", 101, 5, true); // U+2260 not equal to
+    t.insert("\xe2\x88\x92", 102, 8, true); // U+2212 minus sign
+    t.insert("<=>", 103, 5, true);
+  }
+
+  inline std::vector<Corpus> corpora()
+  {
+    return {
+      { "deep nesting"  , deep_nesting(200)  },
+      { "long chain"    , long_chain(500)    },
+      { "many functions", many_functions(50) },
+      { "multi-byte ops", multibyte(300)     },
+      { "signs"         , signs(300)         },
+      { "negated groups", negated_groups(100) }
+    };
+  }
+
+} // bench
+
+#endif // SYARD_BENCH_CORPUS_HH
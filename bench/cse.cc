@@ -0,0 +1,48 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include "bench.hh"
+
+#include <syard/cse.hh>
+#include <math.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace syard;
+
+static double sqrt_(const double *args, unsigned)
+{
+  return sqrt(args[0]);
+}
+
+// a rule set that shares (price*qty) and sqrt(vol)
+BENCH_CASE(cse_rules)
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.function_table().insert("sqrt", 20);
+  for (auto s : { "price", "qty", "vol", "fee" })
+    p.symbol_table().insert(s);
+  Evaluator<double> e;
+  e.insert(20, 1, sqrt_, true);
+  vector<Program<double> > ps;
+  for (unsigned i = 0; i < 200; ++i)
+    ps.push_back(p.compile<double>(("(price*qty) * sqrt(vol) / "
+            + to_string(i % 10 + 1) + " - fee * (price*qty)").c_str()));
+  auto d = cse(ps, e);
+  size_t n = 0;
+  for (auto &x : ps)
+    n += x.code().size();
+  printf("instructions: %zu -> nodes: %zu\n", n, d.nodes().size());
+  double vars[] = { 10.5, 3, 4, 0.25 };
+  vector<double> out(ps.size()), values;
+  bench::measure("separately", 10000, ps.size(), [&] {
+      for (size_t i = 0; i < ps.size(); ++i)
+        out[i] = e.run(ps[i], vars);
+      bench::keep(out[0]);
+      });
+  bench::measure("dag", 10000, ps.size(), [&] {
+      d.run(e, vars, out.data(), values);
+      bench::keep(out[0]);
+      });
+}
@@ -0,0 +1,47 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include "bench.hh"
+
+#include <syard/eval.hh>
+#include <string>
+
+using namespace std;
+using namespace syard;
+
+// string operand stack callbacks vs. the built in evaluator
+BENCH_CASE(eval_short)
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  for (auto s : { "1+2*3", " (1+2)*(2+3)*4^(2*3+4)+2 " }) {
+    printf("%s\n", s);
+    auto &o = p.arg_stack();
+    auto f = [&o](uint8_t id) {
+      auto b = stol(o.top()); o.pop();
+      auto a = stol(o.top()); o.pop();
+      long c = 0;
+      switch (id) {
+        case POWER: c = power<int64_t>(a, b); break;
+        case MULT : c = a * b; break;
+        case PLUS : c = a + b; break;
+      }
+      o.push(to_string(c));
+    };
+    bench::measure("parse string stack", 1000000, 0, [&] {
+        p.parse(s, f);
+        bench::keep(o.top());
+        o.pop();
+        });
+    auto sprog = p.compile(s);
+    bench::measure("run string stack", 1000000, 0, [&] {
+        sprog.run(o, f);
+        bench::keep(o.top());
+        o.pop();
+        });
+    auto prog = p.compile<int64_t>(s);
+    Evaluator<int64_t> e;
+    bench::measure("evaluator", 10000000, 0, [&] {
+        bench::keep(e.run(prog));
+        });
+  }
+}
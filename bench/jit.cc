@@ -0,0 +1,42 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include "bench.hh"
+
+#include <syard/jit.hh>
+#include <math.h>
+
+using namespace std;
+using namespace syard;
+
+// interpreter vs. native code
+BENCH_CASE(jit_run)
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.function_table().insert("sqrt", 20);
+  for (auto s : { "a", "b", "c" })
+    p.symbol_table().insert(s);
+  Evaluator<double> e;
+  e.insert(20, 1, [](const double *a, unsigned) { return sqrt(a[0]); },
+      true);
+  double vars[] = { 1.5, 2.5, 3.5 };
+  for (auto s : { "(a + b) * (a - c) / (b * c + 1) - a * 2 + b / 3",
+      "sqrt(a * a + b * b) + c ^ 2" }) {
+    auto prog = p.compile<double>(s);
+    auto c = Jit_Code::compile(prog, e);
+    printf("%s\n", s);
+    bench::measure("interpreter", 1000000, prog.code().size(), [&] {
+        bench::keep(e.run(prog, vars));
+        vars[0] += 1e-9;
+        });
+    if (!c)
+      continue;
+    bench::measure("native", 1000000, prog.code().size(), [&] {
+        bench::keep(c->run(vars));
+        vars[0] += 1e-9;
+        });
+    bench::measure("jit compile", 10000, prog.code().size(), [&] {
+        bench::keep(Jit_Code::compile(prog, e));
+        });
+  }
+}
@@ -0,0 +1,70 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include "bench.hh"
+
+#include <new>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace bench {
+
+  std::atomic<size_t> allocations {0};
+  std::atomic<size_t> live_bytes {0};
+  std::atomic<size_t> peak_bytes {0};
+
+  static Case *head;
+
+  Case::Case(const char *name, void (*fn)())
+    : name(name), fn(fn), next(head)
+  {
+    head = this;
+  }
+
+} // bench
+
+// i.e. each block is prefixed with its size, such that delete can
+// account for it
+enum { HEADER = alignof(max_align_t) };
+
+void *operator new(size_t n)
+{
+  bench::allocations.fetch_add(1, std::memory_order_relaxed);
+  auto p = static_cast<char*>(malloc(n + HEADER));
+  if (!p)
+    throw std::bad_alloc();
+  memcpy(p, &n, sizeof n);
+  size_t live = bench::live_bytes.fetch_add(n, std::memory_order_relaxed)
+    + n;
+  size_t peak = bench::peak_bytes.load(std::memory_order_relaxed);
+  while (live > peak && !bench::peak_bytes.compare_exchange_weak(peak, live,
+        std::memory_order_relaxed))
+    ;
+  return p + HEADER;
+}
+void operator delete(void *p) noexcept
+{
+  if (!p)
+    return;
+  auto q = static_cast<char*>(p) - HEADER;
+  size_t n;
+  memcpy(&n, q, sizeof n);
+  bench::live_bytes.fetch_sub(n, std::memory_order_relaxed);
+  free(q);
+}
+void operator delete(void *p, size_t) noexcept
+{
+  operator delete(p);
+}
+
+// usage: bench [substring-of-case-name]
+int main(int argc, char **argv)
+{
+  const char *filter = argc > 1 ? argv[1] : "";
+  for (auto c = bench::head; c; c = c->next)
+    if (strstr(c->name, filter)) {
+      printf("# %s\n", c->name);
+      c->fn();
+    }
+  return 0;
+}
@@ -0,0 +1,44 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include "bench.hh"
+
+#include <syard/optimize.hh>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace syard;
+
+// generated formulas with constant subtrees and neutral elements
+BENCH_CASE(optimize_corpus)
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.symbol_table().insert("x");
+  p.symbol_table().insert("y");
+  vector<string> corpus;
+  for (unsigned i = 0; i < 1000; ++i)
+    corpus.push_back("x*" + to_string(i % 7) + "^(2*3+" + to_string(i % 5)
+        + ")*1+y/(" + to_string(i) + "-" + to_string(i % 3)
+        + "+1)-0+(x+y)*1");
+  Evaluator<double> e;
+  vector<Program<double> > ps, qs;
+  size_t before = 0, after = 0;
+  for (auto &s : corpus) {
+    Optimize_Report r;
+    ps.push_back(p.compile<double>(s.c_str()));
+    qs.push_back(optimize(ps.back(), e, &r));
+    before += r.before;
+    after += r.after;
+  }
+  printf("instructions: %zu -> %zu\n", before, after);
+  double vars[] = { 1.5, 2.5 };
+  bench::measure("unoptimized", 1000, corpus.size(), [&] {
+      for (auto &x : ps)
+        bench::keep(e.run(x, vars));
+      });
+  bench::measure("optimized", 1000, corpus.size(), [&] {
+      for (auto &x : qs)
+        bench::keep(e.run(x, vars));
+      });
+}
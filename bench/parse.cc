@@ -0,0 +1,108 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include "bench.hh"
+
+#include <syard/syard.hh>
+#include <syard/program.hh>
+#include <functional>
+#include <string.h>
+
+using namespace std;
+using namespace syard;
+
+static void eval(Stack<int64_t> &o, uint8_t id)
+{
+  auto b = o.top(); o.pop();
+  auto a = o.top(); o.pop();
+  int64_t c = 0;
+  switch (id) {
+    case POWER: c = 1; for (int64_t i = 0; i < b; ++i) c *= a; break;
+    case MULT : c = a * b; break;
+    case DIV  : c = a / b; break;
+    case PLUS : c = a + b; break;
+    case MINUS: c = a - b; break;
+  }
+  o.push(c);
+}
+
+// the per-operator callback cost: std::function vs. inlined template
+BENCH_CASE(parse_callback)
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  Stack<int64_t> o;
+  for (auto s : { "4^(2*3+4)", " (1+2)*(2+3)*4^(2*3+4)+2 " }) {
+    auto e = s + strlen(s);
+    size_t ops = 0;
+    p.parse(s, e, o, [&ops](uint8_t) { ++ops; });
+    o = Stack<int64_t>();
+
+    printf("%s\n", s);
+    std::function<void(uint8_t)> f = [&o](uint8_t id) { eval(o, id); };
+    bench::measure("std::function", 1000000, ops, [&] {
+        p.parse(s, e, o, f);
+        bench::keep(o.top());
+        o.pop();
+        });
+    bench::measure("template", 1000000, ops, [&] {
+        p.parse(s, e, o, [&o](uint8_t id) { eval(o, id); });
+        bench::keep(o.top());
+        o.pop();
+        });
+  }
+}
+
+// without lexing/parsing the callback cost dominates
+BENCH_CASE(run_callback)
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  Stack<int64_t> o;
+  for (auto s : { "4^(2*3+4)", " (1+2)*(2+3)*4^(2*3+4)+2 " }) {
+    auto prog = p.compile<int64_t>(s);
+    size_t ops = prog.code().size() - prog.constants().size();
+
+    printf("%s\n", s);
+    std::function<void(uint8_t)> f = [&o](uint8_t id) { eval(o, id); };
+    bench::measure("std::function", 10000000, ops, [&] {
+        prog.run(o, f);
+        bench::keep(o.top());
+        o.pop();
+        });
+    bench::measure("template", 10000000, ops, [&] {
+        prog.run(o, [&o](uint8_t id) { eval(o, id); });
+        bench::keep(o.top());
+        o.pop();
+        });
+  }
+}
+
+// the cost of malformed input: exception unwinding vs. an error code
+BENCH_CASE(parse_invalid)
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.function_table().insert("max", 20);
+  Stack<int64_t> o;
+  auto f = [&o](uint8_t id) {
+    if (o.size() >= 2)
+      eval(o, id);
+  };
+  for (auto s : { "(1+2)*(2+3", "max(1, 2) + foo(3)", "1 + 2 # 3" }) {
+    auto e = s + strlen(s);
+    printf("%s\n", s);
+    bench::measure("parse/catch", 1000000, 0, [&] {
+        try {
+          p.parse(s, e, o, f);
+        } catch (const std::exception &) {
+        }
+        while (!o.empty())
+          o.pop();
+        });
+    bench::measure("try_parse", 1000000, 0, [&] {
+        bench::keep(p.try_parse(s, e, o, f));
+        while (!o.empty())
+          o.pop();
+        });
+  }
+}
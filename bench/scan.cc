@@ -0,0 +1,76 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include "bench.hh"
+
+#include <syard/scan.hh>
+#include <syard/syard.hh>
+#include <string>
+
+using namespace std;
+using namespace syard;
+
+static const char *isa_name[] = { "scalar", "sse2", "avx2" };
+
+// long runs of a single character class
+BENCH_CASE(scan_kernels)
+{
+  string space(1 << 20, ' ');
+  string number;
+  for (size_t i = 0; i < (1u << 20); ++i)
+    number += "0123456789."[i % 11];
+  string name(1 << 20, 'x');
+  for (auto isa : { SCAN_SCALAR, SCAN_SSE2, SCAN_AVX2 }) {
+    auto k = scan_kernels(isa);
+    if (!k)
+      continue;
+    struct {
+      const char *name;
+      const char *(*fn)(const char *, const char *);
+      const string &s;
+    } cs[] = {
+      { "space" , k->space , space  },
+      { "number", k->number, number },
+      { "name"  , k->name  , name   }
+    };
+    for (auto &c : cs) {
+      string label = string(isa_name[isa]) + " " + c.name;
+      double ns = bench::measure(label.c_str(), 100, 0, [&] {
+          bench::keep(c.fn(c.s.data(), c.s.data() + c.s.size()));
+          });
+      printf("%40s %10.1f MB/s\n", "", c.s.size() / ns * 1000);
+    }
+  }
+}
+
+// generated formulas with heavy padding and long literals
+BENCH_CASE(scan_lex)
+{
+  Operator_Table t;
+  t.insert_default_arithmetic();
+  string s;
+  for (unsigned i = 0; i < 10000; ++i) {
+    s += string(i % 64, ' ');
+    s += i % 3 ? "1234567890123456.25" : "some_long_function_name";
+    s += string(i % 17, '\t');
+    s += "+-*/"[i % 4];
+  }
+  s += "1";
+  size_t tokens = 0;
+  for (auto r = t.lex(s.data(), s.data() + s.size()); r.id != EPSILON;
+      r = t.lex(r.p.second, s.data() + s.size()))
+    ++tokens;
+  for (auto isa : { SCAN_SCALAR, SCAN_SSE2, SCAN_AVX2 }) {
+    if (!scan_kernels(isa))
+      continue;
+    select_scan_isa(isa);
+    string label = string(isa_name[isa]) + " lex";
+    double ns = bench::measure(label.c_str(), 100, tokens, [&] {
+        auto e = s.data() + s.size();
+        for (auto r = t.lex(s.data(), e); r.id != EPSILON;
+            r = t.lex(r.p.second, e))
+          bench::keep(r);
+        });
+    printf("%40s %10.1f MB/s\n", "", s.size() / ns * 1000);
+  }
+  select_scan_isa(best_scan_isa());
+}
@@ -0,0 +1,43 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include "bench.hh"
+
+#include <syard/serialize.hh>
+#include <syard/eval.hh>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace syard;
+
+// a warm start: compiling 100k formulas vs. loading them
+BENCH_CASE(serialize_load)
+{
+  char name[] = "/tmp/syard_bench_XXXXXX";
+  int fd = mkstemp(name);
+  if (fd == -1)
+    return;
+  close(fd);
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.function_table().insert("max", 20);
+  for (auto s : { "price", "qty", "fee" })
+    p.symbol_table().insert(s);
+  vector<string> v;
+  for (unsigned i = 0; i < 100000; ++i)
+    v.push_back("max(price * " + to_string(i % 97) + ", qty) - fee / "
+        + to_string(i % 13 + 1) + ".5");
+  vector<Program<double> > ps(v.size());
+  bench::measure("try_compile", 3, v.size(), [&] {
+      for (size_t i = 0; i < v.size(); ++i)
+        p.try_compile(v[i].data(), v[i].data() + v[i].size(), ps[i]);
+      });
+  save(name, p.grammar(), ps);
+  bench::measure("load", 3, v.size(), [&] {
+      Program_File<double> f(name, p.grammar());
+      bench::keep(f.size());
+      });
+  unlink(name);
+}
@@ -0,0 +1,40 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include "bench.hh"
+
+#include <syard/sheet.hh>
+#include <string>
+
+using namespace std;
+using namespace syard;
+
+// 100 inputs, 10 layers of 100 formulas, one input changes per tick
+BENCH_CASE(sheet_tick)
+{
+  Sheet<double> s;
+  s.parser().operator_table().insert_default_arithmetic();
+  auto name = [](unsigned layer, unsigned i) {
+    string r = "c";
+    r += char('a' + layer);
+    for (unsigned k = 0; k < 3; ++k, i /= 10)
+      r += char('a' + i % 10);
+    return r;
+  };
+  for (unsigned l = 1; l <= 10; ++l)
+    for (unsigned i = 0; i < 100; ++i)
+      s.define(name(l, i).c_str(), (name(l - 1, i) + " * 2 + "
+            + name(l - 1, (i + 1) % 100)).c_str());
+  s.recompute();
+  unsigned t = 0;
+  bench::measure("recompute all", 100, 1000, [&] {
+      for (unsigned i = 0; i < 100; ++i)
+        s.set(name(0, i).c_str(), t++);
+      s.recompute();
+      });
+  bench::measure("one input", 10000, 0, [&] {
+      s.set(name(0, t % 100).c_str(), t);
+      ++t;
+      s.recompute();
+      });
+  printf("last recompute evaluated %zu formulas\n", s.stats().last);
+}
@@ -0,0 +1,40 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include "bench.hh"
+
+#include <syard/static_grammar.hh>
+#include <string.h>
+
+using namespace std;
+using namespace syard;
+
+// the same expressions, lexed via the runtime tables vs. a
+// Static_Grammar
+BENCH_CASE(static_compile)
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.function_table().insert("max", 20);
+  p.function_table().insert("min", 21);
+  p.symbol_table().insert("x");
+  Static_Parser<Static_Grammar<Default_Arithmetic, Functions<
+    Static_Function<20, 'm', 'a', 'x'>,
+    Static_Function<21, 'm', 'i', 'n'> > > > q;
+  q.symbol_table().insert("x");
+  Program<double> r;
+  for (auto s : { "4^(2*3+4)",
+      "max(x * 2, min(3, x)) - 1.5 / (x + 2) ** 2" }) {
+    auto e = s + strlen(s);
+    p.try_compile(s, e, r);
+    size_t tokens = r.code().size();
+    printf("%s\n", s);
+    bench::measure("runtime", 1000000, tokens, [&] {
+        p.try_compile(s, e, r);
+        bench::keep(r.code().size());
+        });
+    bench::measure("static", 1000000, tokens, [&] {
+        q.try_compile(s, e, r);
+        bench::keep(r.code().size());
+        });
+  }
+}
@@ -0,0 +1,53 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include "bench.hh"
+
+#include <syard/program.hh>
+#include <syard/stream.hh>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+
+using namespace std;
+using namespace syard;
+
+// splits and compiles a 32 MiB file of formulas
+BENCH_CASE(stream_mmap)
+{
+  char name[] = "/tmp/syard_bench_XXXXXX";
+  int fd = mkstemp(name);
+  if (fd == -1)
+    return;
+  FILE *f = fdopen(fd, "w");
+  size_t n = 0;
+  for (unsigned i = 0; n < 32 * 1024 * 1024; ++i) {
+    string s = "max(price * " + to_string(i % 97) + ", qty) - fee / "
+      + to_string(i % 13 + 1) + ".5" + (i % 3 ? "\n" : "; ");
+    fwrite(s.data(), 1, s.size(), f);
+    n += s.size();
+  }
+  fclose(f);
+
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.function_table().insert("max", 20);
+  for (auto s : { "price", "qty", "fee" })
+    p.symbol_table().insert(s);
+  Mapped_File m(name);
+  double mb = m.size() / 1e6;
+  size_t exprs = 0;
+  double ns = bench::measure("split", 3, 0, [&] {
+      split(m, [&exprs](const char *, const char *) { ++exprs; });
+      });
+  printf("%-40s %10.1f MB/s\n", "", mb / ns * 1e9);
+  Program<double> prog;
+  size_t errors = 0;
+  ns = bench::measure("split + try_compile", 3, 0, [&] {
+      split(m, [&](const char *b, const char *e) {
+          errors += bool(p.try_compile(b, e, prog));
+          });
+      });
+  printf("%-40s %10.1f MB/s (%zu errors)\n", "", mb / ns * 1e9, errors);
+  unlink(name);
+}
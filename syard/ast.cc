@@ -0,0 +1,145 @@
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "ast.hh"
+
+#include <algorithm>
+#include <new>
+#include <stdint.h>
+#include <string.h>
+
+using namespace std;
+
+namespace syard {
+
+  static_assert(sizeof(Node) % alignof(const Node*) == 0,
+      "the argument pointers directly follow a node");
+
+  void Arena::grow(size_t n)
+  {
+    size_t size = max(size_t(BLOCK_SIZE), n);
+    if (!blocks_.empty())
+      size = max(size, 2 * blocks_.back().size);
+    blocks_.push_back(Block{unique_ptr<char[]>(new char[size]), size});
+    pos_ = blocks_.back().data.get();
+    end_ = pos_ + size;
+  }
+  void *Arena::allocate(size_t n, size_t align)
+  {
+    size_t pad = (align - reinterpret_cast<uintptr_t>(pos_) % align) % align;
+    if (!pos_ || size_t(end_ - pos_) < pad + n) {
+      grow(n + align);
+      pad = (align - reinterpret_cast<uintptr_t>(pos_) % align) % align;
+    }
+    void *r = pos_ + pad;
+    pos_ += pad + n;
+    used_ += n;
+    return r;
+  }
+  void Arena::clear()
+  {
+    if (blocks_.size() > 1) {
+      blocks_.front() = std::move(blocks_.back());
+      blocks_.resize(1);
+    }
+    pos_ = blocks_.empty() ? nullptr : blocks_.front().data.get();
+    end_ = blocks_.empty() ? nullptr : pos_ + blocks_.front().size;
+    used_ = 0;
+  }
+
+  void Ast::clear()
+  {
+    arena_.clear();
+    root_ = nullptr;
+    size_ = 0;
+    stack_.clear();
+  }
+  Node *Ast::make(uint8_t code, uint8_t argc,
+      const pair<const char*, const char*> &p)
+  {
+    void *m = arena_.allocate(sizeof(Node) + argc * sizeof(const Node*),
+        alignof(Node));
+    ++size_;
+    return new (m) Node{p, code, argc, 0, false};
+  }
+  Error_Code Ast::push_leaf(uint8_t code, uint16_t slot, bool negative,
+      const pair<const char*, const char*> &p)
+  {
+    Node *n = make(code, 0, p);
+    n->slot = slot;
+    n->negative = negative;
+    stack_.push_back(n);
+    return ERR_NONE;
+  }
+  Error_Code Ast::push_node(uint8_t code, unsigned argc,
+      const pair<const char*, const char*> &p)
+  {
+    if (argc > UINT8_MAX)
+      return ERR_LIMIT;
+    if (stack_.size() < argc)
+      return ERR_MISSING_OPERAND;
+    Node *n = make(code, argc, p);
+    auto args = reinterpret_cast<const Node**>(n + 1);
+    copy(stack_.end() - argc, stack_.end(), args);
+    stack_.resize(stack_.size() - argc);
+    stack_.push_back(n);
+    return ERR_NONE;
+  }
+  Error_Code Ast::finish()
+  {
+    // i.e. a list of expressions without an operator, e.g. `1 2`
+    if (stack_.size() > 1)
+      return ERR_MISSING_OPERAND;
+    root_ = stack_.empty() ? nullptr : stack_.back();
+    return ERR_NONE;
+  }
+
+  Parse_Error Parser::try_parse_ast(const char *begin, const char *end,
+      Ast &a)
+  {
+    a.clear();
+    auto e = shunt(begin, end,
+        [&a](const Sign &sign, const pair<const char*, const char*> &p) {
+          return a.push_leaf(OPERAND, 0, sign.negative, p);
+        },
+        [&a](const pair<const char*, const char*> &p, uint16_t slot) {
+          return a.push_leaf(VARIABLE, slot, false, p);
+        },
+        [&a](const Operator *op, unsigned argc,
+          const pair<const char*, const char*> &p) {
+          return a.push_node(op->id, argc, p);
+        });
+    if (e)
+      return e;
+    if (auto c = a.finish())
+      return Parse_Error{c, size_t(end - begin), make_pair(end, end)};
+    return e;
+  }
+  void Parser::parse_ast(const char *begin, const char *end, Ast &a)
+  {
+    if (auto e = try_parse_ast(begin, end, a))
+      e.raise();
+  }
+  void Parser::parse_ast(const char *s, Ast &a)
+  {
+    parse_ast(s, s+strlen(s), a);
+  }
+
+} // syard
@@ -0,0 +1,111 @@
+#ifndef SYARD_AST_HH
+#define SYARD_AST_HH
+
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+
+#include "syard.hh"
+
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace syard {
+
+  // A bump allocator, i.e. the memory is only released all at once.
+  class Arena {
+    private:
+      struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+      };
+      std::vector<Block> blocks_;
+      char *pos_ {nullptr};
+      char *end_ {nullptr};
+      size_t used_ {0};
+
+      void grow(size_t n);
+    public:
+      enum { BLOCK_SIZE = 4096 };
+      void *allocate(size_t n, size_t align);
+      // keeps the largest block for reuse
+      void clear();
+      // i.e. allocated bytes, not counting the unused rest of the blocks
+      size_t used() const { return used_; }
+  };
+
+  // A node of an Ast, i.e. an operand, a variable or the application of
+  // an operator/function. Nodes are immutable once built and reference
+  // the source text instead of copying it.
+  struct Node {
+    // the token in the source, i.e. literal, name or operator
+    std::pair<const char *, const char *> p;
+    // OPERAND, VARIABLE, NEGATE or an operator/function id (cf.
+    // Instruction)
+    uint8_t code;
+    uint8_t argc;
+    // of a VARIABLE
+    uint16_t slot;
+    // i.e. the OPERAND is preceded by an odd number of MINUS signs,
+    // negated variables, groups and calls are NEGATE nodes
+    bool negative;
+
+    // the argument pointers are stored inline, directly after the node
+    const Node *arg(unsigned i) const
+    {
+      return reinterpret_cast<const Node * const *>(this + 1)[i];
+    }
+  };
+
+  // The result of Parser::parse_ast(). The nodes are allocated in RPN
+  // order from an arena, i.e. a node is placed right after its last
+  // argument's subtree, and they are freed at once when the Ast is
+  // destroyed or reused.
+  class Ast {
+    private:
+      Arena arena_;
+      const Node *root_ {nullptr};
+      size_t size_ {0};
+      // the nodes that don't have a parent, yet
+      std::vector<const Node*> stack_;
+
+      friend class Parser;
+      void clear();
+      Node *make(uint8_t code, uint8_t argc,
+          const std::pair<const char*, const char*> &p);
+      Error_Code push_leaf(uint8_t code, uint16_t slot, bool negative,
+          const std::pair<const char*, const char*> &p);
+      Error_Code push_node(uint8_t code, unsigned argc,
+          const std::pair<const char*, const char*> &p);
+      Error_Code finish();
+    public:
+      // nullptr for an empty expression
+      const Node *root() const { return root_; }
+      // number of nodes
+      size_t size() const { return size_; }
+      const Arena &arena() const { return arena_; }
+  };
+
+} // syard
+
+#endif // SYARD_AST_HH
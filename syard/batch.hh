@@ -0,0 +1,197 @@
+#ifndef SYARD_BATCH_HH
+#define SYARD_BATCH_HH
+
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+
+#include "eval.hh"
+#include "program.hh"
+
+#include <algorithm>
+#include <array>
+#include <stddef.h>
+#include <stdexcept>
+#include <vector>
+
+namespace syard {
+
+  // Evaluates one program over columns of inputs, i.e. variable slot i
+  // reads from columns[i].
+  //
+  // The program is executed vector-at-a-time: each instruction is
+  // applied to a block of rows before the next one, such that the
+  // element-wise loops of the built in operators are auto-vectorized.
+  // The input columns aren't copied and constants are only broadcast
+  // once per run.
+  template <typename T>
+  class Batch_Evaluator {
+    public:
+      // computes out[0..n) from args[0..argc)[0..n), out may alias
+      // args[0]
+      using Function = void (*)(T *out, const T * const *args,
+          unsigned argc, size_t n);
+      enum { VARIADIC = 255, BLOCK = 512 };
+
+      Batch_Evaluator();
+      void insert(uint8_t id, unsigned arity, Function f);
+
+      // P is a Program<T> or a Program_View<T>
+      template <typename P>
+        void run(const P &p, const T * const *columns, T *out,
+            size_t n) const;
+    private:
+      enum Kind : uint8_t {
+        K_UNKNOWN, K_CONSTANT, K_VARIABLE, K_POWER, K_MULT, K_DIV, K_PLUS,
+        K_MINUS, K_NEGATE, K_CALL
+      };
+      struct Entry {
+        Function fn {nullptr};
+        uint8_t arity {0};
+      };
+      std::array<Kind, 256> kinds_;
+      std::array<Entry, 256> functions_;
+  };
+
+  template <typename T>
+    Batch_Evaluator<T>::Batch_Evaluator()
+    {
+      kinds_.fill(K_UNKNOWN);
+      kinds_[OPERAND]  = K_CONSTANT;
+      kinds_[VARIABLE] = K_VARIABLE;
+      kinds_[POWER]    = K_POWER;
+      kinds_[MULT]     = K_MULT;
+      kinds_[DIV]      = K_DIV;
+      kinds_[PLUS]     = K_PLUS;
+      kinds_[MINUS]    = K_MINUS;
+      kinds_[NEGATE]   = K_NEGATE;
+    }
+  template <typename T>
+    void Batch_Evaluator<T>::insert(uint8_t id, unsigned arity, Function f)
+    {
+      if (id < FIRST_ID)
+        throw std::invalid_argument("reserved id");
+      if (arity > VARIADIC)
+        throw std::invalid_argument("arity out of range");
+      kinds_[id] = K_CALL;
+      functions_[id].fn = f;
+      functions_[id].arity = arity;
+    }
+
+  template <typename T> template <typename P>
+    void Batch_Evaluator<T>::run(const P &p,
+        const T * const *columns, T *out, size_t n) const
+    {
+      auto &code = p.code();
+      if (code.empty())
+        throw std::underflow_error("empty program");
+      if (p.variables() && !columns)
+        throw std::invalid_argument("program references variables");
+      for (auto &i : code) {
+        if (kinds_[i.code] == K_UNKNOWN)
+          throw std::range_error("unknown operator/function id: "
+              + std::to_string(i.code));
+        if (kinds_[i.code] == K_CALL
+            && functions_[i.code].arity != VARIADIC
+            && functions_[i.code].arity != i.argc)
+          throw std::invalid_argument("wrong number of arguments");
+      }
+      size_t depth = p.max_depth();
+      // one block of scratch space per stack slot
+      std::vector<T> scratch(depth * BLOCK);
+      // the stack of operands, i.e. pointers to the current block of an
+      // input column, a constant block or a scratch block
+      std::vector<const T*> stack(depth);
+      std::vector<std::vector<T> > constants(p.constants().size());
+
+      for (size_t r = 0; r < n; r += BLOCK) {
+        size_t m = std::min(size_t(BLOCK), n - r);
+        size_t sp = 0;
+        for (size_t k = 0; k < code.size(); ++k) {
+          auto &i = code[k];
+          // the result of the last instruction goes directly to out
+          T *d = k + 1 == code.size()
+            ? out + r : scratch.data() + (sp - i.argc) * BLOCK;
+          switch (kinds_[i.code]) {
+            case K_CONSTANT:
+              {
+                auto &c = constants[i.arg];
+                if (c.empty())
+                  c.assign(BLOCK, p.constants()[i.arg]);
+                stack[sp++] = c.data();
+              }
+              continue;
+            case K_VARIABLE:
+              stack[sp++] = columns[i.arg] + r;
+              continue;
+            case K_CALL:
+              sp -= i.argc;
+              functions_[i.code].fn(d, stack.data() + sp, i.argc, m);
+              break;
+            case K_NEGATE:
+              {
+                const T *a = stack[--sp];
+                for (size_t j = 0; j < m; ++j)
+                  d[j] = -a[j];
+              }
+              break;
+            default:
+              {
+                --sp;
+                const T *a = stack[sp - 1];
+                const T *b = stack[sp];
+                --sp;
+                switch (kinds_[i.code]) {
+                  case K_POWER:
+                    for (size_t j = 0; j < m; ++j)
+                      d[j] = power(a[j], b[j]);
+                    break;
+                  case K_MULT:
+                    for (size_t j = 0; j < m; ++j)
+                      d[j] = a[j] * b[j];
+                    break;
+                  case K_DIV:
+                    for (size_t j = 0; j < m; ++j)
+                      d[j] = divide(a[j], b[j]);
+                    break;
+                  case K_PLUS:
+                    for (size_t j = 0; j < m; ++j)
+                      d[j] = a[j] + b[j];
+                    break;
+                  case K_MINUS:
+                    for (size_t j = 0; j < m; ++j)
+                      d[j] = a[j] - b[j];
+                    break;
+                  default:
+                    break;
+                }
+              }
+          }
+          stack[sp++] = d;
+        }
+        // i.e. a program without any operator
+        if (stack[sp - 1] != out + r)
+          std::copy(stack[sp - 1], stack[sp - 1] + m, out + r);
+      }
+    }
+
+} // syard
+
+#endif // SYARD_BATCH_HH
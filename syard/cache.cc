@@ -0,0 +1,82 @@
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "cache.hh"
+#include "scan.hh"
+
+#include <algorithm>
+#include <string.h>
+
+using namespace std;
+
+namespace syard {
+
+  void normalize(const Operator_Table &t, const char *begin, const char *end,
+      string &out)
+  {
+    out.resize(end - begin);
+    char *b = &out[0];
+    char *o = b;
+    // collapses the whitespace runs into single spaces, without
+    // branches, as the runs are short and irregular
+    bool last = true;
+    for (auto p = begin; p != end; ++p) {
+      bool space = is_space(*p);
+      *o = space ? ' ' : *p;
+      o += !(space & last);
+      last = space;
+    }
+    if (o != b && o[-1] == ' ')
+      --o;
+    // i.e. keep the separating ones
+    char *w = b;
+    for (char *r = b; r != o; ++r) {
+      if (*r == ' ') {
+        char x = w[-1];
+        char y = r[1];
+        if (!((is_number(x) && is_number(y)) || (is_name(x) && is_name(y))
+              || t.joins(x, y)))
+          continue;
+      }
+      *w++ = *r;
+    }
+    out.resize(w - b);
+  }
+
+  uint64_t hash_text(const string &s, uint64_t seed)
+  {
+    const uint64_t k = UINT64_C(0x9e3779b97f4a7c15);
+    uint64_t h = (seed ^ s.size()) * k;
+    auto p = s.data();
+    auto e = p + s.size();
+    // i.e. a word at a time
+    for ( ; e - p >= 8; p += 8) {
+      uint64_t w;
+      memcpy(&w, p, 8);
+      h = (h ^ w) * k;
+      h ^= h >> 31;
+    }
+    uint64_t w = 0;
+    memcpy(&w, p, e - p);
+    h = (h ^ w) * k;
+    return h ^ (h >> 29);
+  }
+
+} // syard
@@ -0,0 +1,216 @@
+#ifndef SYARD_CACHE_HH
+#define SYARD_CACHE_HH
+
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+
+#include "program.hh"
+#include "syard.hh"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+
+namespace syard {
+
+  // Removes the whitespace that doesn't separate tokens, i.e. all of it
+  // except single spaces between two number bytes, two name bytes or
+  // two bytes that occur in sequence within an operator (e.g. `- -`
+  // vs. `--`). Expressions with the same normalized text are lexed into
+  // the same tokens.
+  void normalize(const Operator_Table &t, const char *begin, const char *end,
+      std::string &out);
+  // i.e. of the normalized text, seed: e.g. the grammar version
+  uint64_t hash_text(const std::string &s, uint64_t seed = 0);
+
+  struct Cache_Stats {
+    size_t hits {0};
+    size_t misses {0};
+    size_t evictions {0};
+    size_t entries {0};
+    // i.e. the estimated memory usage
+    size_t bytes {0};
+  };
+
+  // A thread-safe LRU cache of compiled programs, keyed by the
+  // normalized expression text and the grammar version.
+  //
+  // The entries are distributed over independently locked shards, each
+  // with its own LRU list and an equal share of the memory budget. The
+  // programs are handed out as shared pointers, i.e. they stay valid
+  // when they are evicted.
+  template <typename T>
+  class Program_Cache {
+    public:
+      using Ptr = std::shared_ptr<const Program<T> >;
+
+      // budget: in bytes, for the programs, keys and bookkeeping
+      explicit Program_Cache(size_t budget, unsigned shards = 16);
+
+      // compiles with p on a miss, i.e. each thread passes its own
+      // parser, throws like Parser::compile() (errors aren't cached)
+      Ptr get(Parser &p, const char *begin, const char *end);
+      Ptr get(Parser &p, const char *s);
+
+      Cache_Stats stats() const;
+      void clear();
+    private:
+      struct Entry {
+        uint64_t hash;
+        uint64_t version;
+        std::string key;
+        Ptr program;
+        size_t bytes;
+      };
+      using List = std::list<Entry>;
+      struct Shard {
+        mutable std::mutex mutex;
+        // most recently used first
+        List lru;
+        std::unordered_map<uint64_t, typename List::iterator> index;
+        size_t bytes {0};
+        size_t hits {0};
+        size_t misses {0};
+        size_t evictions {0};
+        // i.e. a cache line between the shards against false sharing,
+        // as array new doesn't honor alignas(64) in C++14
+        char pad[64];
+      };
+      std::unique_ptr<Shard[]> shards_;
+      unsigned n_;
+      size_t budget_; // per shard
+
+      Shard &shard(uint64_t h) { return shards_[(h >> 32) % n_]; }
+      static size_t footprint(const Program<T> &p, const std::string &key);
+  };
+
+  template <typename T>
+    Program_Cache<T>::Program_Cache(size_t budget, unsigned shards)
+    : shards_(new Shard[shards ? shards : 1]),
+      n_(shards ? shards : 1),
+      budget_(budget / n_)
+    {
+    }
+
+  template <typename T>
+    size_t Program_Cache<T>::footprint(const Program<T> &p,
+        const std::string &key)
+    {
+      // i.e. list node, index node and shared pointer control block
+      // included
+      return sizeof(Entry) + sizeof(Program<T>) + 8 * sizeof(void*)
+        + key.size()
+        + p.code().capacity() * sizeof(Instruction)
+        + p.constants().capacity() * sizeof(T);
+    }
+
+  template <typename T>
+    typename Program_Cache<T>::Ptr Program_Cache<T>::get(Parser &p,
+        const char *s)
+    {
+      return get(p, s, s + strlen(s));
+    }
+  template <typename T>
+    typename Program_Cache<T>::Ptr Program_Cache<T>::get(Parser &p,
+        const char *begin, const char *end)
+    {
+      // i.e. no allocation on a hit
+      static thread_local std::string key;
+      auto &g = p.grammar();
+      normalize(g.operator_table(), begin, end, key);
+      uint64_t version = g.version();
+      uint64_t h = hash_text(key, version);
+      Shard &s = shard(h);
+      {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto i = s.index.find(h);
+        if (i != s.index.end() && i->second->version == version
+            && i->second->key == key) {
+          ++s.hits;
+          s.lru.splice(s.lru.begin(), s.lru, i->second);
+          return i->second->program;
+        }
+        ++s.misses;
+      }
+
+      // compile without holding the lock, i.e. concurrent misses of the
+      // same expression may compile it twice
+      Ptr r = std::make_shared<const Program<T> >(p.compile<T>(begin, end));
+      size_t bytes = footprint(*r, key);
+      if (bytes > budget_)
+        return r;
+      std::lock_guard<std::mutex> lock(s.mutex);
+      auto i = s.index.find(h);
+      // i.e. a racing insert or a hash collision
+      if (i != s.index.end()) {
+        s.bytes -= i->second->bytes;
+        s.lru.erase(i->second);
+        s.index.erase(i);
+      }
+      s.lru.push_front(Entry{h, version, key, r, bytes});
+      s.index.emplace(h, s.lru.begin());
+      s.bytes += bytes;
+      while (s.bytes > budget_) {
+        auto &e = s.lru.back();
+        s.bytes -= e.bytes;
+        s.index.erase(e.hash);
+        s.lru.pop_back();
+        ++s.evictions;
+      }
+      return r;
+    }
+
+  template <typename T>
+    Cache_Stats Program_Cache<T>::stats() const
+    {
+      Cache_Stats r;
+      for (unsigned i = 0; i < n_; ++i) {
+        auto &s = shards_[i];
+        std::lock_guard<std::mutex> lock(s.mutex);
+        r.hits      += s.hits;
+        r.misses    += s.misses;
+        r.evictions += s.evictions;
+        r.entries   += s.lru.size();
+        r.bytes     += s.bytes;
+      }
+      return r;
+    }
+  template <typename T>
+    void Program_Cache<T>::clear()
+    {
+      for (unsigned i = 0; i < n_; ++i) {
+        auto &s = shards_[i];
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.lru.clear();
+        s.index.clear();
+        s.bytes = 0;
+      }
+    }
+
+} // syard
+
+#endif // SYARD_CACHE_HH
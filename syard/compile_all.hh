@@ -0,0 +1,131 @@
+#ifndef SYARD_COMPILE_ALL_HH
+#define SYARD_COMPILE_ALL_HH
+
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+
+#include "program.hh"
+#include "syard.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <stddef.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace syard {
+
+  template <typename T>
+  struct Compile_Result {
+    Program<T> program;
+    // empty on success
+    std::string error;
+    bool ok() const { return error.empty(); }
+  };
+
+  // Compiles many expressions in parallel against a shared grammar.
+  //
+  // Each worker owns a Parser (i.e. its stacks are reused) and a
+  // contiguous range of the input which it consumes in chunks. A worker
+  // that is done steals chunks from the ranges of the others, i.e. the
+  // load is balanced even if the expensive expressions are clustered.
+  // A threads value of 0 means hardware concurrency. Throws
+  // invalid_argument unless g is frozen, i.e. before starting any
+  // worker.
+  template <typename T>
+    std::vector<Compile_Result<T> > compile_all(
+        std::shared_ptr<const Grammar> g,
+        const std::vector<std::string> &exprs, unsigned threads = 0);
+
+  template <typename T>
+    std::vector<Compile_Result<T> > compile_all(
+        std::shared_ptr<const Grammar> g,
+        const std::vector<std::string> &exprs, unsigned threads)
+    {
+      enum { CHUNK = 64 };
+      // i.e. Parser(g) doesn't throw in the workers
+      if (!g || !g->frozen())
+        throw std::invalid_argument("shared grammar must be frozen");
+      std::vector<Compile_Result<T> > rs(exprs.size());
+      if (!threads)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+      threads = std::max(size_t(1), std::min(size_t(threads),
+            (exprs.size() + CHUNK - 1) / CHUNK));
+
+      // padded, as the cursors are hammered on by all workers - i.e. at
+      // a stride of two cache lines no two cursors share a line, no
+      // matter how the (not over-aligned) storage is aligned
+      struct Range {
+        std::atomic<size_t> next;
+        size_t end;
+        char pad[128 - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+      };
+      std::vector<Range> ranges(threads);
+      for (unsigned i = 0; i < threads; ++i) {
+        ranges[i].next = exprs.size() * i / threads;
+        ranges[i].end  = exprs.size() * (i+1) / threads;
+      }
+
+      auto work = [&](unsigned id) {
+        Parser p(g);
+        for (unsigned k = 0; k < threads; ++k) {
+          // i.e. first the own range, then steal from the others
+          Range &range = ranges[(id + k) % threads];
+          for (;;) {
+            size_t b = range.next.fetch_add(CHUNK,
+                std::memory_order_relaxed);
+            if (b >= range.end)
+              break;
+            size_t stop = std::min(b + CHUNK, range.end);
+            for (size_t i = b; i < stop; ++i) {
+              auto &s = exprs[i];
+              auto &res = rs[i];
+              try {
+                // i.e. malformed input doesn't unwind
+                if (auto err = p.try_compile(s.data(), s.data() + s.size(),
+                      res.program)) {
+                  res.error = err.message();
+                  res.program.clear();
+                }
+              } catch (const std::exception &ex) {
+                res.error = ex.what();
+                res.program.clear();
+              }
+            }
+          }
+        }
+      };
+      std::vector<std::thread> ts;
+      for (unsigned i = 1; i < threads; ++i)
+        ts.emplace_back(work, i);
+      work(0);
+      for (auto &t : ts)
+        t.join();
+      return rs;
+    }
+
+} // syard
+
+#endif // SYARD_COMPILE_ALL_HH
@@ -0,0 +1,232 @@
+#ifndef SYARD_CSE_HH
+#define SYARD_CSE_HH
+
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+
+#include "eval.hh"
+#include "program.hh"
+
+#include <algorithm>
+#include <functional>
+#include <math.h>
+#include <stddef.h>
+#include <stdexcept>
+#include <stdint.h>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace syard {
+
+  // Several expressions compiled into one DAG, i.e. each distinct
+  // subexpression is a single node that is computed once per run.
+  //
+  // The nodes are topologically sorted, node i is computed from the
+  // values of the nodes args()[first, first+argc), which all precede i.
+  template <typename T>
+  class Dag_Program {
+    public:
+      struct Node {
+        // OPERAND: constants()[arg], VARIABLE: variable slot arg,
+        // otherwise an operator/function id (cf. Instruction)
+        uint8_t  code;
+        uint8_t  argc;
+        uint16_t arg;
+        uint32_t first;
+      };
+    private:
+      std::vector<Node> nodes_;
+      std::vector<uint32_t> args_;
+      std::vector<T> constants_;
+      std::vector<uint32_t> outputs_;
+      size_t variables_ {0};
+
+      template <typename U> friend Dag_Program<U> cse(
+          const std::vector<Program<U> > &ps, const Evaluator<U> &e);
+    public:
+      const std::vector<Node> &nodes() const { return nodes_; }
+      const std::vector<uint32_t> &args() const { return args_; }
+      const std::vector<T> &constants() const { return constants_; }
+      // i.e. the node of expression i
+      const std::vector<uint32_t> &outputs() const { return outputs_; }
+      size_t variables() const { return variables_; }
+
+      // out[i] is the value of expression i, values is scratch space
+      // that can be reused between runs
+      void run(const Evaluator<T> &e, const T *vars, T *out,
+          std::vector<T> &values) const;
+      void run(const Evaluator<T> &e, const T *vars, T *out) const;
+  };
+
+  // Merges the programs by hash-consing, i.e. equal constants,
+  // variables and applications of built in operators/pure functions
+  // (cf. Evaluator::insert()) to equal arguments become one node. For
+  // arithmetic types, the arguments of + and * are also ordered, as
+  // those are commutative. Impure functions are never merged.
+  template <typename T>
+    Dag_Program<T> cse(const std::vector<Program<T> > &ps,
+        const Evaluator<T> &e);
+
+  namespace impl {
+
+    // i.e. -0.0 and 0.0 are distinct constants
+    template <typename T> inline bool same_constant(const T &a, const T &b)
+    {
+      return a == b;
+    }
+    inline bool same_constant(double a, double b)
+    {
+      return a == b && signbit(a) == signbit(b);
+    }
+
+  }
+
+  template <typename T>
+    Dag_Program<T> cse(const std::vector<Program<T> > &ps,
+        const Evaluator<T> &e)
+    {
+      using Node = typename Dag_Program<T>::Node;
+      Dag_Program<T> r;
+      // i.e. the hash of a node's code, arg and arguments
+      std::unordered_multimap<uint64_t, uint32_t> index;
+      std::vector<uint32_t> stack;
+      std::vector<uint32_t> args;
+      auto mix = [](uint64_t h, uint64_t x) {
+        h = (h ^ x) * UINT64_C(0x9e3779b97f4a7c15);
+        return h ^ (h >> 32);
+      };
+      // returns an existing equal node or appends a new one
+      auto intern = [&](uint8_t code, uint16_t arg, const T *constant,
+          bool merge) -> uint32_t {
+        uint64_t h = mix(mix(code, arg), args.size());
+        if (constant)
+          h = mix(h, std::hash<T>()(*constant));
+        for (auto a : args)
+          h = mix(h, a);
+        if (merge) {
+          auto range = index.equal_range(h);
+          for (auto i = range.first; i != range.second; ++i) {
+            auto &n = r.nodes_[i->second];
+            if (n.code != code || n.argc != args.size())
+              continue;
+            if (constant) {
+              if (impl::same_constant(r.constants_[n.arg], *constant))
+                return i->second;
+            } else if (n.arg == arg && std::equal(args.begin(), args.end(),
+                  r.args_.begin() + n.first)) {
+              return i->second;
+            }
+          }
+        }
+        if (r.nodes_.size() >= UINT32_MAX)
+          throw std::overflow_error("too many nodes");
+        if (constant) {
+          if (r.constants_.size() > UINT16_MAX)
+            throw std::overflow_error("too many constants");
+          arg = r.constants_.size();
+          r.constants_.push_back(*constant);
+        }
+        uint32_t id = r.nodes_.size();
+        r.nodes_.push_back(Node{code, uint8_t(args.size()), arg,
+            uint32_t(r.args_.size())});
+        r.args_.insert(r.args_.end(), args.begin(), args.end());
+        if (merge)
+          index.emplace(h, id);
+        return id;
+      };
+
+      for (auto &p : ps) {
+        stack.clear();
+        for (auto &i : p.code()) {
+          args.clear();
+          if (i.code == OPERAND) {
+            stack.push_back(intern(OPERAND, 0, &p.constants()[i.arg], true));
+            continue;
+          }
+          if (i.code == VARIABLE) {
+            stack.push_back(intern(VARIABLE, i.arg, nullptr, true));
+            if (size_t(i.arg) + 1 > r.variables_)
+              r.variables_ = i.arg + 1;
+            continue;
+          }
+          if (stack.size() < i.argc)
+            throw std::underflow_error("not enough operands");
+          args.assign(stack.end() - i.argc, stack.end());
+          stack.resize(stack.size() - i.argc);
+          if (std::is_arithmetic<T>::value && e.builtin(i.code)
+              && (i.code == PLUS || i.code == MULT))
+            std::sort(args.begin(), args.end());
+          stack.push_back(intern(i.code, 0, nullptr, e.pure(i.code)));
+        }
+        if (stack.size() != 1)
+          throw std::underflow_error("expression doesn't yield one value");
+        r.outputs_.push_back(stack.back());
+      }
+      return r;
+    }
+
+  template <typename T>
+    void Dag_Program<T>::run(const Evaluator<T> &e, const T *vars, T *out)
+    const
+    {
+      std::vector<T> values;
+      run(e, vars, out, values);
+    }
+  template <typename T>
+    void Dag_Program<T>::run(const Evaluator<T> &e, const T *vars, T *out,
+        std::vector<T> &values) const
+    {
+      if (variables_ && !vars)
+        throw std::invalid_argument("program references variables");
+      values.resize(nodes_.size());
+      T small[8];
+      std::vector<T> big;
+      for (size_t k = 0; k < nodes_.size(); ++k) {
+        auto &n = nodes_[k];
+        auto a = args_.data() + n.first;
+        switch (n.code) {
+          case OPERAND:
+            values[k] = constants_[n.arg];
+            break;
+          case VARIABLE:
+            values[k] = vars[n.arg];
+            break;
+          default:
+            {
+              T *xs = small;
+              if (n.argc > 8) {
+                big.resize(n.argc);
+                xs = big.data();
+              }
+              for (unsigned j = 0; j < n.argc; ++j)
+                xs[j] = values[a[j]];
+              values[k] = e.apply(n.code, xs, n.argc);
+            }
+        }
+      }
+      for (size_t i = 0; i < outputs_.size(); ++i)
+        out[i] = values[outputs_[i]];
+    }
+
+} // syard
+
+#endif // SYARD_CSE_HH
@@ -0,0 +1,311 @@
+#ifndef SYARD_EVAL_HH
+#define SYARD_EVAL_HH
+
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+
+#include "program.hh"
+
+#include <array>
+#include <math.h>
+#include <stdexcept>
+#include <stdint.h>
+#include <vector>
+
+#if defined(__GNUC__) && !defined(SYARD_NO_THREADED_DISPATCH)
+  // i.e. labels as values
+  #define SYARD_THREADED_DISPATCH 1
+#endif
+
+namespace syard {
+
+  // the semantics of the default arithmetic operators
+  template <typename T> inline T power(T a, T b) { return pow(a, b); }
+  template <typename T> inline T divide(T a, T b) { return a / b; }
+  template <> inline int64_t power(int64_t a, int64_t b)
+  {
+    if (b < 0) {
+      if (a == 0)
+        throw std::domain_error("zero to negative power");
+      return a == 1 ? 1 : a == -1 ? (b % 2 ? -1 : 1) : 0;
+    }
+    int64_t r = 1;
+    for (;;) {
+      if ((b & 1) && __builtin_mul_overflow(r, a, &r))
+        throw std::overflow_error("power overflow");
+      b >>= 1;
+      // i.e. without squaring a once more after the last bit
+      if (!b)
+        return r;
+      // i.e. the result would overflow, too
+      if (__builtin_mul_overflow(a, a, &a))
+        throw std::overflow_error("power overflow");
+    }
+  }
+  template <> inline int64_t divide(int64_t a, int64_t b)
+  {
+    if (!b)
+      throw std::domain_error("division by zero");
+    if (a == INT64_MIN && b == -1)
+      throw std::overflow_error("division overflow");
+    return a / b;
+  }
+
+  // Evaluates compiled programs over a native operand stack.
+  //
+  // The default arithmetic operators (cf. Operator_Table::
+  // insert_default_arithmetic()) and NEGATE are built in, other
+  // operators and functions are registered by id.
+  template <typename T>
+  class Evaluator {
+    public:
+      using Function = T (*)(const T *args, unsigned argc);
+      using Binary = T (*)(T a, T b);
+      enum { VARIADIC = 255, MAX_STACK = 64 };
+
+      Evaluator();
+      // also overrides the built in operators, pure functions (i.e.
+      // without side effects) may be evaluated at compile time, cf.
+      // optimize()
+      void insert(uint8_t id, unsigned arity, Function f, bool pure = false);
+      // an n-ary function that folds its (at least one) arguments with
+      // f, e.g. max(a, b, c) as f(f(a, b), c), i.e. without an argument
+      // array and arity check - declare the function with a min arity
+      // of 1 (cf. Function_Table::insert())
+      void insert_reduction(uint8_t id, Binary f, bool pure = false);
+
+      // i.e. one of the default arithmetic operators or NEGATE
+      bool builtin(uint8_t id) const;
+      bool pure(uint8_t id) const;
+      // applies a single operator/function
+      T apply(uint8_t id, const T *args, unsigned argc) const;
+
+      // vars[i] is the value of variable slot i, P is a Program<T> or a
+      // Program_View<T> (cf. serialize.hh)
+      template <typename P>
+        T run(const P &p, const T *vars = nullptr) const;
+    private:
+      enum Kind : uint8_t {
+        K_UNKNOWN, K_CONSTANT, K_VARIABLE, K_POWER, K_MULT, K_DIV, K_PLUS,
+        K_MINUS, K_NEGATE, K_CALL, K_REDUCE
+      };
+      struct Entry {
+        Function fn {nullptr};
+        Binary reduce {nullptr};
+        uint8_t arity {0};
+        bool pure {false};
+      };
+      std::array<Kind, 256> kinds_;
+      std::array<Entry, 256> functions_;
+  };
+
+  template <typename T>
+    Evaluator<T>::Evaluator()
+    {
+      kinds_.fill(K_UNKNOWN);
+      kinds_[OPERAND] = K_CONSTANT;
+      kinds_[VARIABLE] = K_VARIABLE;
+      kinds_[POWER]   = K_POWER;
+      kinds_[MULT]    = K_MULT;
+      kinds_[DIV]     = K_DIV;
+      kinds_[PLUS]    = K_PLUS;
+      kinds_[MINUS]   = K_MINUS;
+      kinds_[NEGATE]  = K_NEGATE;
+    }
+  template <typename T>
+    void Evaluator<T>::insert(uint8_t id, unsigned arity, Function f,
+        bool pure)
+    {
+      if (id < FIRST_ID)
+        throw std::invalid_argument("reserved id");
+      if (arity > VARIADIC)
+        throw std::invalid_argument("arity out of range");
+      kinds_[id] = K_CALL;
+      functions_[id].fn = f;
+      functions_[id].arity = arity;
+      functions_[id].pure = pure;
+    }
+  template <typename T>
+    void Evaluator<T>::insert_reduction(uint8_t id, Binary f, bool pure)
+    {
+      if (id < FIRST_ID)
+        throw std::invalid_argument("reserved id");
+      kinds_[id] = K_REDUCE;
+      functions_[id].reduce = f;
+      functions_[id].pure = pure;
+    }
+  template <typename T>
+    bool Evaluator<T>::builtin(uint8_t id) const
+    {
+      return kinds_[id] >= K_POWER && kinds_[id] <= K_NEGATE;
+    }
+  template <typename T>
+    bool Evaluator<T>::pure(uint8_t id) const
+    {
+      return builtin(id) || ((kinds_[id] == K_CALL || kinds_[id] == K_REDUCE)
+          && functions_[id].pure);
+    }
+  template <typename T>
+    T Evaluator<T>::apply(uint8_t id, const T *args, unsigned argc) const
+    {
+      switch (kinds_[id]) {
+        case K_POWER: return power(args[0], args[1]);
+        case K_MULT : return args[0] * args[1];
+        case K_DIV  : return divide(args[0], args[1]);
+        case K_PLUS : return args[0] + args[1];
+        case K_MINUS: return args[0] - args[1];
+        case K_NEGATE: return -args[0];
+        case K_CALL :
+          {
+            auto &f = functions_[id];
+            if (f.arity != VARIADIC && f.arity != argc)
+              throw std::invalid_argument("wrong number of arguments");
+            return f.fn(args, argc);
+          }
+        case K_REDUCE:
+          {
+            if (!argc)
+              throw std::invalid_argument("wrong number of arguments");
+            auto f = functions_[id].reduce;
+            T r = args[0];
+            for (unsigned i = 1; i < argc; ++i)
+              r = f(r, args[i]);
+            return r;
+          }
+        default:
+          throw std::range_error("unknown operator/function id: "
+              + std::to_string(id));
+      }
+    }
+
+  template <typename T> template <typename P>
+    T Evaluator<T>::run(const P &p, const T *vars) const
+    {
+      T small[MAX_STACK];
+      std::vector<T> big;
+      T *sp = small;
+      if (p.max_depth() > MAX_STACK) {
+        big.resize(p.max_depth());
+        sp = big.data();
+      }
+      // sp points to the next free slot
+      auto ip = p.code().data();
+      auto end = ip + p.code().size();
+      auto c = p.constants().data();
+      if (ip == end)
+        throw std::underflow_error("empty program");
+      if (p.variables() && !vars)
+        throw std::invalid_argument("program references variables");
+
+#if SYARD_THREADED_DISPATCH
+      static const void * const labels[] = {
+        &&l_unknown, &&l_constant, &&l_variable, &&l_power, &&l_mult,
+        &&l_div, &&l_plus, &&l_minus, &&l_negate, &&l_call,
+        &&l_reduce
+      };
+      #define SYARD_NEXT \
+        do { \
+          if (++ip == end) \
+            goto l_done; \
+          goto *labels[kinds_[ip->code]]; \
+        } while (0)
+      goto *labels[kinds_[ip->code]];
+#else
+      #define SYARD_NEXT \
+        do { \
+          if (++ip == end) \
+            goto l_done; \
+          goto l_dispatch; \
+        } while (0)
+      l_dispatch:
+      switch (kinds_[ip->code]) {
+        case K_UNKNOWN : goto l_unknown;
+        case K_CONSTANT: goto l_constant;
+        case K_VARIABLE: goto l_variable;
+        case K_POWER   : goto l_power;
+        case K_MULT    : goto l_mult;
+        case K_DIV     : goto l_div;
+        case K_PLUS    : goto l_plus;
+        case K_MINUS   : goto l_minus;
+        case K_NEGATE  : goto l_negate;
+        case K_CALL    : goto l_call;
+        case K_REDUCE  : goto l_reduce;
+      }
+#endif
+
+      l_constant:
+        *sp++ = c[ip->arg];
+        SYARD_NEXT;
+      l_variable:
+        *sp++ = vars[ip->arg];
+        SYARD_NEXT;
+      l_power:
+        --sp; sp[-1] = power(sp[-1], sp[0]);
+        SYARD_NEXT;
+      l_mult:
+        --sp; sp[-1] = sp[-1] * sp[0];
+        SYARD_NEXT;
+      l_div:
+        --sp; sp[-1] = divide(sp[-1], sp[0]);
+        SYARD_NEXT;
+      l_plus:
+        --sp; sp[-1] = sp[-1] + sp[0];
+        SYARD_NEXT;
+      l_minus:
+        --sp; sp[-1] = sp[-1] - sp[0];
+        SYARD_NEXT;
+      l_negate:
+        sp[-1] = -sp[-1];
+        SYARD_NEXT;
+      l_call:
+        {
+          auto &f = functions_[ip->code];
+          if (f.arity != VARIADIC && f.arity != ip->argc)
+            throw std::invalid_argument("wrong number of arguments");
+          sp -= ip->argc;
+          *sp = f.fn(sp, ip->argc);
+          ++sp;
+        }
+        SYARD_NEXT;
+      l_reduce:
+        {
+          auto f = functions_[ip->code].reduce;
+          unsigned n = ip->argc;
+          if (!n)
+            throw std::invalid_argument("wrong number of arguments");
+          sp -= n;
+          T r = sp[0];
+          for (unsigned i = 1; i < n; ++i)
+            r = f(r, sp[i]);
+          *sp++ = r;
+        }
+        SYARD_NEXT;
+      l_unknown:
+        throw std::range_error("unknown operator/function id: "
+            + std::to_string(ip->code));
+      l_done:
+      #undef SYARD_NEXT
+      return sp[-1];
+    }
+
+} // syard
+
+#endif // SYARD_EVAL_HH
@@ -0,0 +1,342 @@
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "jit.hh"
+
+#include <math.h>
+#include <stdexcept>
+#include <string.h>
+#include <vector>
+
+#if SYARD_JIT
+  #include <sys/mman.h>
+#endif
+
+using namespace std;
+
+namespace syard {
+
+#if SYARD_JIT
+
+  namespace {
+
+    using Function = double (*)(const double *vars, impl::Jit_State *s);
+
+    enum Reg { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+      R8, R9, R10, R11, R12, R13, R14, R15 };
+    // SSE2 opcodes, i.e. 0F xx
+    enum Sse : uint8_t {
+      MOVSD_LOAD = 0x10, MOVSD_STORE = 0x11, MOVAPD = 0x28,
+      ADDSD = 0x58, MULSD = 0x59, SUBSD = 0x5c, DIVSD = 0x5e
+    };
+
+    // i.e. just the few instructions the code generator needs
+    class Assembler {
+      private:
+        vector<uint8_t> b_;
+        // positions of RIP relative displacements and the constants
+        // they reference
+        vector<pair<size_t, size_t> > fixups_;
+
+        void rex(unsigned r, unsigned rm, bool w = false)
+        {
+          uint8_t x = 0x40 | w << 3 | (r >> 3) << 2 | (rm >> 3);
+          if (x != 0x40)
+            byte(x);
+        }
+        // i.e. movsd is F2 0F xx, movapd 66 0F xx
+        static uint8_t prefix(Sse op)
+        {
+          return op == MOVAPD ? 0x66 : 0xf2;
+        }
+      public:
+        const vector<uint8_t> &bytes() const { return b_; }
+        void byte(uint8_t x) { b_.push_back(x); }
+        void u32(uint32_t x)
+        {
+          for (unsigned i = 0; i < 4; ++i)
+            byte(x >> (8 * i));
+        }
+        void u64(uint64_t x)
+        {
+          for (unsigned i = 0; i < 8; ++i)
+            byte(x >> (8 * i));
+        }
+        // op xmm, [base + disp32] (or the reverse for MOVSD_STORE)
+        void sse(Sse op, unsigned xmm, Reg base, int32_t disp)
+        {
+          byte(prefix(op));
+          rex(xmm, base);
+          byte(0x0f); byte(op);
+          byte(0x80 | (xmm & 7) << 3 | (base & 7));
+          if ((base & 7) == RSP)
+            byte(0x24);
+          u32(disp);
+        }
+        // op dst, src
+        void sse(Sse op, unsigned dst, unsigned src)
+        {
+          if (op == MOVAPD && dst == src)
+            return;
+          byte(prefix(op));
+          rex(dst, src);
+          byte(0x0f); byte(op);
+          byte(0xc0 | (dst & 7) << 3 | (src & 7));
+        }
+        // movsd xmm, [rip + constant i]
+        void load_constant(unsigned xmm, size_t i)
+        {
+          byte(0xf2);
+          rex(xmm, 0);
+          byte(0x0f); byte(MOVSD_LOAD);
+          byte((xmm & 7) << 3 | 5);
+          fixups_.emplace_back(b_.size(), i);
+          u32(0);
+        }
+        // mov dst, src (64 bit)
+        void mov(Reg dst, Reg src)
+        {
+          rex(src, dst, true);
+          byte(0x89);
+          byte(0xc0 | (src & 7) << 3 | (dst & 7));
+        }
+        void mov(Reg dst, uint32_t imm)
+        {
+          rex(0, dst);
+          byte(0xb8 | (dst & 7));
+          u32(imm);
+        }
+        // lea dst, [rsp + disp32]
+        void lea_rsp(Reg dst, int32_t disp)
+        {
+          rex(dst, RSP, true);
+          byte(0x8d);
+          byte(0x80 | (dst & 7) << 3 | RSP);
+          byte(0x24);
+          u32(disp);
+        }
+        void push(Reg r) { rex(0, r); byte(0x50 | (r & 7)); }
+        void pop(Reg r) { rex(0, r); byte(0x58 | (r & 7)); }
+        // add/sub rsp, imm32
+        void add_rsp(int32_t x) { byte(0x48); byte(0x81); byte(0xc4); u32(x); }
+        void sub_rsp(int32_t x) { byte(0x48); byte(0x81); byte(0xec); u32(x); }
+        // mov rax, f; call rax
+        void call(const void *f)
+        {
+          byte(0x48); byte(0xb8); u64(reinterpret_cast<uint64_t>(f));
+          byte(0xff); byte(0xd0);
+        }
+        void ret() { byte(0xc3); }
+        // xmm = -xmm, i.e. movq rax, xmm; btc rax, 63; movq xmm, rax -
+        // flipping the sign bit like this doesn't need an (aligned)
+        // xorpd mask
+        void negate(unsigned xmm)
+        {
+          byte(0x66); rex(xmm, RAX, true);
+          byte(0x0f); byte(0x7e); byte(0xc0 | (xmm & 7) << 3);
+          byte(0x48); byte(0x0f); byte(0xba); byte(0xf8); byte(63);
+          byte(0x66); rex(xmm, RAX, true);
+          byte(0x0f); byte(0x6e); byte(0xc0 | (xmm & 7) << 3);
+        }
+        // appends the constant pool (8 byte aligned) and resolves the
+        // RIP relative references into it
+        void finish(const double *constants, size_t n)
+        {
+          while (b_.size() % 8)
+            byte(0xcc);
+          size_t pool = b_.size();
+          b_.resize(pool + n * sizeof(double));
+          if (n)
+            memcpy(&b_[pool], constants, n * sizeof(double));
+          for (auto &f : fixups_) {
+            uint32_t d = pool + f.second * sizeof(double) - (f.first + 4);
+            memcpy(&b_[f.first], &d, sizeof d);
+          }
+        }
+    };
+
+    double call_function(impl::Jit_State *s, unsigned id,
+        const double *args, unsigned argc) noexcept
+    {
+      try {
+        return s->evaluator->apply(id, args, argc);
+      } catch (...) {
+        if (!s->error)
+          s->error = current_exception();
+        return NAN;
+      }
+    }
+    double call_power(double a, double b)
+    {
+      return power(a, b);
+    }
+
+    // i.e. the spill slots, plus 8 bytes such that rsp is 16 byte aligned
+    // at calls (after the 2 pushes)
+    enum { FRAME = Jit_Code::MAX_DEPTH * 8 + 8 };
+
+  }
+
+  unique_ptr<Jit_Code> Jit_Code::compile(const Instruction *code,
+      size_t n, const double *constants, size_t max_depth,
+      size_t variables, const Evaluator<double> &e)
+  {
+    if (!n || max_depth > MAX_DEPTH)
+      return nullptr;
+    for (size_t i = 0; i < n; ++i)
+      if (code[i].code != OPERAND && code[i].code != VARIABLE
+          && !e.pure(code[i].code))
+        return nullptr;
+
+    Assembler a;
+    size_t constant_count = 0;
+    // vars in rbx, the Jit_State in r13
+    a.push(RBX);
+    a.push(R13);
+    a.sub_rsp(FRAME);
+    a.mov(RBX, RDI);
+    a.mov(R13, RSI);
+    // i.e. stack slot i is xmm i
+    unsigned sp = 0;
+    auto spill = [&a](unsigned b, unsigned e) {
+      for (unsigned i = b; i < e; ++i)
+        a.sse(MOVSD_STORE, i, RSP, 8 * i);
+    };
+    auto reload = [&a](unsigned b, unsigned e) {
+      for (unsigned i = b; i < e; ++i)
+        a.sse(MOVSD_LOAD, i, RSP, 8 * i);
+    };
+    for (size_t k = 0; k < n; ++k) {
+      auto &i = code[k];
+      // i.e. a max_depth that doesn't match the code
+      if (sp == MAX_DEPTH || (i.code >= FIRST_ID && i.argc > sp)
+          || (i.code == NEGATE && (i.argc != 1 || !sp)))
+        return nullptr;
+      if (i.code == OPERAND) {
+        a.load_constant(sp++, i.arg);
+        constant_count = max(constant_count, size_t(i.arg) + 1);
+        continue;
+      }
+      if (i.code == VARIABLE) {
+        a.sse(MOVSD_LOAD, sp++, RBX, 8 * i.arg);
+        continue;
+      }
+      if (i.code == NEGATE) {
+        a.negate(sp - 1);
+        continue;
+      }
+      if (e.builtin(i.code) && i.argc == 2 && i.code != POWER) {
+        Sse op = i.code == PLUS ? ADDSD : i.code == MINUS ? SUBSD
+          : i.code == MULT ? MULSD : DIVSD;
+        a.sse(op, sp - 2, sp - 1);
+        --sp;
+        continue;
+      }
+      if (e.builtin(i.code) && i.argc == 2) {
+        unsigned x = sp - 2;
+        spill(0, x);
+        a.sse(MOVAPD, 0, x);
+        a.sse(MOVAPD, 1, x + 1);
+        a.call(reinterpret_cast<const void*>(call_power));
+        a.sse(MOVAPD, x, 0);
+        reload(0, x);
+        --sp;
+        continue;
+      }
+      // i.e. a pure function (or a built in operator with an unexpected
+      // argc)
+      spill(0, sp);
+      sp -= i.argc;
+      a.mov(RDI, R13);
+      a.mov(RSI, uint32_t(i.code));
+      a.lea_rsp(RDX, 8 * sp);
+      a.mov(RCX, uint32_t(i.argc));
+      a.call(reinterpret_cast<const void*>(call_function));
+      a.sse(MOVAPD, sp, 0);
+      reload(0, sp);
+      ++sp;
+    }
+    a.sse(MOVAPD, 0, sp - 1);
+    a.add_rsp(FRAME);
+    a.pop(R13);
+    a.pop(RBX);
+    a.ret();
+    a.finish(constants, constant_count);
+
+    auto &b = a.bytes();
+    void *p = mmap(nullptr, b.size(), PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+      return nullptr;
+    memcpy(p, b.data(), b.size());
+    // i.e. W^X
+    if (mprotect(p, b.size(), PROT_READ | PROT_EXEC)) {
+      munmap(p, b.size());
+      return nullptr;
+    }
+    unique_ptr<Jit_Code> r(new Jit_Code());
+    r->code_ = p;
+    r->size_ = b.size();
+    r->variables_ = variables;
+    r->evaluator_ = &e;
+    return r;
+  }
+  Jit_Code::~Jit_Code()
+  {
+    if (code_)
+      munmap(code_, size_);
+  }
+  double Jit_Code::run(const double *vars) const
+  {
+    if (variables_ && !vars)
+      throw invalid_argument("program references variables");
+    impl::Jit_State s{evaluator_, nullptr};
+    double r = reinterpret_cast<Function>(code_)(vars, &s);
+    if (s.error)
+      rethrow_exception(s.error);
+    return r;
+  }
+
+#else
+
+  unique_ptr<Jit_Code> Jit_Code::compile(const Instruction *, size_t,
+      const double *, size_t, size_t, const Evaluator<double> &)
+  {
+    return nullptr;
+  }
+  Jit_Code::~Jit_Code()
+  {
+  }
+  double Jit_Code::run(const double *) const
+  {
+    throw logic_error("no native code");
+  }
+
+#endif
+
+  Tiered_Program::Tiered_Program(Program<double> p,
+      const Evaluator<double> &e, size_t threshold)
+    : program_(std::move(p)), evaluator_(e), threshold_(threshold)
+  {
+    if (!threshold_)
+      code_ = Jit_Code::compile(program_, evaluator_);
+  }
+
+} // syard
@@ -0,0 +1,126 @@
+#ifndef SYARD_JIT_HH
+#define SYARD_JIT_HH
+
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+
+#include "eval.hh"
+#include "program.hh"
+
+#include <exception>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) && defined(__unix__) && !defined(SYARD_NO_JIT)
+  #define SYARD_JIT 1
+#endif
+
+namespace syard {
+
+  namespace impl {
+
+    // i.e. a call from native code into a function of the Evaluator
+    struct Jit_State {
+      const Evaluator<double> *evaluator;
+      // exceptions can't unwind through the native code, thus they are
+      // caught and rethrown after it returned
+      std::exception_ptr error;
+    };
+
+  } // impl
+
+  // Native x86-64 code of one Program<double>, i.e. straight-line SSE2
+  // without any dispatch.
+  //
+  // The operand stack lives in the xmm registers, the default
+  // arithmetic operators are single instructions, POWER calls pow() and
+  // pure functions are called via the Evaluator (i.e. they are spilled
+  // around calls). Thus, the results are the same as the ones of
+  // Evaluator::run().
+  class Jit_Code {
+    private:
+      void *code_ {nullptr};
+      size_t size_ {0};
+      size_t variables_ {0};
+      const Evaluator<double> *evaluator_ {nullptr};
+
+      Jit_Code() =default;
+    public:
+      // i.e. one xmm register per stack slot
+      enum { MAX_DEPTH = 16 };
+
+      ~Jit_Code();
+      Jit_Code(const Jit_Code &) =delete;
+      Jit_Code &operator=(const Jit_Code &) =delete;
+
+      // returns nullptr if the program can't be compiled, i.e. it
+      // is empty, deeper than MAX_DEPTH, references operators that
+      // aren't built in or functions that aren't pure, or the platform
+      // isn't supported (cf. SYARD_JIT), e must outlive the result
+      template <typename P>
+        static std::unique_ptr<Jit_Code> compile(const P &p,
+            const Evaluator<double> &e)
+        {
+          return compile(p.code().data(), p.code().size(),
+              p.constants().data(), p.max_depth(), p.variables(), e);
+        }
+      static std::unique_ptr<Jit_Code> compile(const Instruction *code,
+          size_t n, const double *constants, size_t max_depth,
+          size_t variables, const Evaluator<double> &e);
+
+      // cf. Evaluator::run()
+      double run(const double *vars = nullptr) const;
+      // of the machine code
+      size_t size() const { return size_; }
+  };
+
+  // Evaluates a program with the interpreter until it was run threshold
+  // times, then compiles it to native code, i.e. only hot programs pay
+  // the compile time. If the program can't be compiled, it stays
+  // interpreted. A threshold of 0 compiles right away. Not thread-safe,
+  // as run() counts.
+  class Tiered_Program {
+    private:
+      Program<double> program_;
+      const Evaluator<double> &evaluator_;
+      std::unique_ptr<Jit_Code> code_;
+      size_t runs_ {0};
+      size_t threshold_;
+    public:
+      Tiered_Program(Program<double> p, const Evaluator<double> &e,
+          size_t threshold = 1000);
+      double run(const double *vars = nullptr)
+      {
+        if (code_)
+          return code_->run(vars);
+        if (++runs_ == threshold_)
+          code_ = Jit_Code::compile(program_, evaluator_);
+        return evaluator_.run(program_, vars);
+      }
+      bool native() const { return bool(code_); }
+      size_t runs() const { return runs_; }
+      const Program<double> &program() const { return program_; }
+  };
+
+} // syard
+
+#endif // SYARD_JIT_HH
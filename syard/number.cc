@@ -0,0 +1,134 @@
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "number.hh"
+
+#include <locale.h>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+using namespace std;
+
+namespace syard {
+
+  Error_Code try_parse_number(const char *begin, const char *end,
+      bool negative, int64_t &r)
+  {
+    if (begin == end)
+      return ERR_MALFORMED_NUMBER;
+    uint64_t limit = negative ? uint64_t(INT64_MAX) + 1 : INT64_MAX;
+    uint64_t v = 0;
+    for (auto p = begin; p != end; ++p) {
+      if (*p < '0' || *p > '9')
+        return ERR_MALFORMED_NUMBER;
+      unsigned d = *p - '0';
+      if (v > (limit - d) / 10)
+        return ERR_NUMBER_RANGE;
+      v = v * 10 + d;
+    }
+    r = negative ? int64_t(0 - v) : int64_t(v);
+    return ERR_NONE;
+  }
+  template <> int64_t parse_number<int64_t>(const char *begin,
+      const char *end, bool negative)
+  {
+    int64_t r;
+    switch (try_parse_number(begin, end, negative, r)) {
+      case ERR_NONE:
+        return r;
+      case ERR_NUMBER_RANGE:
+        throw overflow_error("integer out of range: " + string(begin, end));
+      default:
+        if (begin == end)
+          throw range_error("empty number");
+        throw range_error("malformed integer: " + string(begin, end));
+    }
+  }
+
+  // i.e. the powers of ten that are exactly representable as double
+  static const double pow10_tab[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21,
+    1e22
+  };
+
+  // i.e. independent of setlocale(), e.g. of a decimal comma
+  static double c_strtod(const char *s)
+  {
+    static const locale_t c_locale = newlocale(LC_ALL_MASK, "C", locale_t(0));
+    return strtod_l(s, nullptr, c_locale);
+  }
+
+  Error_Code try_parse_number(const char *begin, const char *end,
+      bool negative, double &r)
+  {
+    uint64_t m = 0;
+    unsigned digits = 0;
+    unsigned frac = 0;
+    bool dot = false;
+    for (auto p = begin; p != end; ++p) {
+      if (*p == '.') {
+        if (dot)
+          return ERR_MALFORMED_NUMBER;
+        dot = true;
+        continue;
+      }
+      if (*p < '0' || *p > '9')
+        return ERR_MALFORMED_NUMBER;
+      if (m || *p != '0')
+        ++digits;
+      if (digits > 19)
+        continue;
+      m = m * 10 + (*p - '0');
+      frac += dot;
+    }
+    if (begin == end || (dot && end - begin == 1))
+      return ERR_MALFORMED_NUMBER;
+    // Clinger's fast path: both mantissa and the power of ten are exact,
+    // thus a single division is correctly rounded
+    if (digits <= 19 && m < (uint64_t(1) << 53) && frac <= 22) {
+      double x = double(m) / pow10_tab[frac];
+      r = negative ? -x : x;
+      return ERR_NONE;
+    }
+    char buf[64];
+    double x;
+    if (size_t(end - begin) < sizeof buf) {
+      memcpy(buf, begin, end - begin);
+      buf[end - begin] = 0;
+      x = c_strtod(buf);
+    } else {
+      x = c_strtod(string(begin, end).c_str());
+    }
+    r = negative ? -x : x;
+    return ERR_NONE;
+  }
+  template <> double parse_number<double>(const char *begin,
+      const char *end, bool negative)
+  {
+    double r;
+    if (try_parse_number(begin, end, negative, r))
+      throw range_error("malformed number: " + string(begin, end));
+    return r;
+  }
+
+} // syard
@@ -0,0 +1,50 @@
+#ifndef SYARD_NUMBER_HH
+#define SYARD_NUMBER_HH
+
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+
+#include "syard.hh"
+
+#include <stdint.h>
+
+namespace syard {
+
+  // Converts an OPERAND token (i.e. [0-9.]+) without allocating,
+  // throws range_error on malformed and overflow_error on out-of-range
+  // input.
+  template <typename T>
+    T parse_number(const char *begin, const char *end, bool negative);
+
+  template <> int64_t parse_number<int64_t>(const char *begin,
+      const char *end, bool negative);
+  template <> double parse_number<double>(const char *begin,
+      const char *end, bool negative);
+  // i.e. returns ERR_MALFORMED_NUMBER or ERR_NUMBER_RANGE instead of
+  // throwing, r is only assigned on success
+  Error_Code try_parse_number(const char *begin, const char *end,
+      bool negative, int64_t &r);
+  Error_Code try_parse_number(const char *begin, const char *end,
+      bool negative, double &r);
+
+} // syard
+
+#endif // SYARD_NUMBER_HH
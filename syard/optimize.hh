@@ -0,0 +1,184 @@
+#ifndef SYARD_OPTIMIZE_HH
+#define SYARD_OPTIMIZE_HH
+
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+
+#include "eval.hh"
+#include "program.hh"
+
+#include <exception>
+#include <math.h>
+#include <stddef.h>
+#include <type_traits>
+#include <vector>
+
+namespace syard {
+
+  struct Optimize_Report {
+    // number of instructions
+    size_t before {0};
+    size_t after {0};
+    // operators/functions evaluated at compile time
+    size_t folded {0};
+    // operators removed by algebraic identities
+    size_t simplified {0};
+  };
+
+  // Folds constant subexpressions of built in operators and of pure
+  // functions (cf. Evaluator::insert()) and removes operations with
+  // neutral elements, i.e. x*1, 1*x, x/1, x^1, x-0 and - for integral
+  // types only, as -0.0+0.0 is +0.0 - x+0, 0+x. For floating point x-0
+  // is only simplified with +0.0, as -0.0-(-0.0) is +0.0. Double
+  // negations (e.g. -(-x)) cancel out.
+  //
+  // Subexpressions that throw when evaluated (e.g. 1/0) aren't folded,
+  // thus they still throw at runtime.
+  template <typename T>
+    Program<T> optimize(const Program<T> &p, const Evaluator<T> &e,
+        Optimize_Report *report = nullptr);
+
+  namespace impl {
+
+    // i.e. x - v == x for all x
+    template <typename T> inline bool is_right_zero(const T &v)
+    {
+      return v == T(0);
+    }
+    inline bool is_right_zero(float v)
+    {
+      return v == 0 && !signbit(v);
+    }
+    inline bool is_right_zero(double v)
+    {
+      return v == 0 && !signbit(v);
+    }
+
+  }
+
+  template <typename T>
+    Program<T> optimize(const Program<T> &p, const Evaluator<T> &e,
+        Optimize_Report *report)
+    {
+      struct Item {
+        Instruction i;
+        T value;
+      };
+      // i.e. the value of a stack entry is computed by out[begin, end)
+      struct Entry {
+        size_t begin;
+        bool constant;
+      };
+      std::vector<Item> out;
+      std::vector<Entry> stack;
+      std::vector<T> args;
+      Optimize_Report r;
+      r.before = p.code().size();
+
+      auto is_const = [&](const Entry &x, T v) {
+        return x.constant && out[x.begin].value == v;
+      };
+      for (auto &i : p.code()) {
+        if (i.code == OPERAND) {
+          stack.push_back(Entry{out.size(), true});
+          out.push_back(Item{i, p.constants()[i.arg]});
+          continue;
+        }
+        if (i.code == VARIABLE) {
+          stack.push_back(Entry{out.size(), false});
+          out.push_back(Item{i, T()});
+          continue;
+        }
+        auto first = stack.end() - i.argc;
+        bool all_const = true;
+        for (auto x = first; x != stack.end(); ++x)
+          all_const = all_const && x->constant;
+        if (all_const && e.pure(i.code)) {
+          args.clear();
+          for (auto x = first; x != stack.end(); ++x)
+            args.push_back(out[x->begin].value);
+          try {
+            T v = e.apply(i.code, args.data(), i.argc);
+            size_t b = i.argc ? first->begin : out.size();
+            out.resize(b);
+            stack.erase(first, stack.end());
+            stack.push_back(Entry{b, true});
+            out.push_back(Item{Instruction{OPERAND, 0, 0}, v});
+            ++r.folded;
+            continue;
+          } catch (const std::exception &) {
+          }
+        }
+        // i.e. -(-x)
+        if (i.code == NEGATE && i.argc == 1 && out.back().i.code == NEGATE) {
+          out.pop_back();
+          ++r.simplified;
+          continue;
+        }
+        if (i.argc == 2 && e.builtin(i.code)) {
+          auto &a = stack[stack.size() - 2];
+          auto &b = stack[stack.size() - 1];
+          bool integral = std::is_integral<T>::value;
+          // drop the right operand, i.e. x op neutral
+          if (((i.code == MULT || i.code == DIV || i.code == POWER)
+                && is_const(b, T(1)))
+              || (i.code == MINUS && b.constant
+                && impl::is_right_zero(out[b.begin].value))
+              || (i.code == PLUS && integral && is_const(b, T(0)))) {
+            out.resize(b.begin);
+            stack.pop_back();
+            ++r.simplified;
+            continue;
+          }
+          // drop the left operand, i.e. neutral op x
+          if ((i.code == MULT && is_const(a, T(1)))
+              || (i.code == PLUS && integral && is_const(a, T(0)))) {
+            out.erase(out.begin() + a.begin, out.begin() + b.begin);
+            a.constant = b.constant;
+            stack.pop_back();
+            ++r.simplified;
+            continue;
+          }
+        }
+        size_t b = i.argc ? first->begin : out.size();
+        stack.erase(first, stack.end());
+        stack.push_back(Entry{b, false});
+        out.push_back(Item{i, T()});
+      }
+
+      Program<T> q;
+      for (auto &x : out) {
+        if (x.i.code == OPERAND)
+          q.push_constant(x.value);
+        else if (x.i.code == VARIABLE)
+          q.push_variable(x.i.arg);
+        else
+          q.push_operator(x.i.code, x.i.argc);
+      }
+      r.after = q.code().size();
+      if (report)
+        *report = r;
+      return q;
+    }
+
+} // syard
+
+#endif // SYARD_OPTIMIZE_HH
@@ -0,0 +1,215 @@
+#ifndef SYARD_PROGRAM_HH
+#define SYARD_PROGRAM_HH
+
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+
+#include "syard.hh"
+
+#include <stddef.h>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
+#include <utility>
+#include <vector>
+
+namespace syard {
+
+  // One RPN step. Codes below FIRST_ID are opcodes (i.e. OPERAND: push
+  // constants()[arg], VARIABLE: push the value of variable slot arg,
+  // NEGATE: negate the top of the stack, with an argc of 1), codes >=
+  // FIRST_ID are operator/function ids that consume argc operands.
+  struct Instruction {
+    uint8_t  code;
+    uint8_t  argc;
+    uint16_t arg;
+  };
+
+  // The result of Parser::compile(), i.e. an expression in reverse polish
+  // notation that can be replayed without lexing/parsing it again.
+  template <typename T>
+  class Program {
+    private:
+      std::vector<Instruction> code_;
+      std::vector<T> constants_;
+      size_t depth_ {0};
+      size_t max_depth_ {0};
+      size_t variables_ {0};
+
+      void push(Instruction i);
+    public:
+      void push_constant(T v);
+      void push_variable(uint16_t slot);
+      void push_operator(uint8_t id, uint8_t argc);
+
+      const std::vector<Instruction> &code() const { return code_; }
+      const std::vector<T> &constants() const { return constants_; }
+      // operand stack size required to run the program
+      size_t max_depth() const { return max_depth_; }
+      // i.e. the highest referenced variable slot plus one
+      size_t variables() const { return variables_; }
+      bool empty() const { return code_.empty(); }
+      // operand stack depth after the last instruction
+      size_t depth() const { return depth_; }
+      // keeps the capacity
+      void clear();
+
+      // pushes the constants onto s and calls f(id) or f(id, argc) for
+      // each operator, i.e. like Parser::parse() without the lexing and
+      // parsing, throws for programs that reference variables
+      template <typename F> void run(Stack<T> &s, F f) const;
+  };
+
+  template <typename T>
+    void Program<T>::push(Instruction i)
+    {
+      code_.push_back(i);
+      ++depth_;
+      if (depth_ > max_depth_)
+        max_depth_ = depth_;
+    }
+  template <typename T>
+    void Program<T>::clear()
+    {
+      code_.clear();
+      constants_.clear();
+      depth_ = max_depth_ = variables_ = 0;
+    }
+  template <typename T>
+    void Program<T>::push_constant(T v)
+    {
+      if (constants_.size() > UINT16_MAX)
+        throw std::overflow_error("too many constants in expression");
+      push(Instruction{OPERAND, 0, static_cast<uint16_t>(constants_.size())});
+      constants_.push_back(std::move(v));
+    }
+  template <typename T>
+    void Program<T>::push_variable(uint16_t slot)
+    {
+      push(Instruction{VARIABLE, 0, slot});
+      if (slot >= variables_)
+        variables_ = slot + 1;
+    }
+  template <typename T>
+    void Program<T>::push_operator(uint8_t id, uint8_t argc)
+    {
+      if (depth_ < argc)
+        throw std::underflow_error("not enough operands");
+      code_.push_back(Instruction{id, argc, 0});
+      depth_ = depth_ - argc + 1;
+      if (depth_ > max_depth_)
+        max_depth_ = depth_;
+    }
+
+  template <typename T> template <typename F>
+    void Program<T>::run(Stack<T> &s, F f) const
+    {
+      for (auto &i : code_) {
+        if (i.code == OPERAND)
+          s.push(constants_[i.arg]);
+        else if (i.code == VARIABLE)
+          throw std::range_error("variables require an Evaluator");
+        else
+          impl::emit(f, i.code, i.argc);
+      }
+    }
+
+  namespace impl {
+
+    // the shunt() callbacks of try_compile(), i.e. for operands,
+    // variables and operators/functions
+    template <typename T>
+    struct Try_Compile {
+      Program<T> &r;
+
+      Error_Code operator()(const Sign &sign,
+          const std::pair<const char*, const char*> &p) const
+      {
+        if (r.constants().size() > UINT16_MAX)
+          return ERR_LIMIT;
+        T v;
+        auto e = try_to_operand<T>(sign, p, v);
+        if (!e)
+          r.push_constant(std::move(v));
+        return e;
+      }
+      Error_Code operator()(const std::pair<const char*, const char*> &,
+          uint16_t slot) const
+      {
+        r.push_variable(slot);
+        return ERR_NONE;
+      }
+      Error_Code operator()(const Operator *op, unsigned argc,
+          const std::pair<const char*, const char*> &) const
+      {
+        if (argc > UINT8_MAX)
+          return ERR_LIMIT;
+        if (r.depth() < argc)
+          return ERR_MISSING_OPERAND;
+        r.push_operator(op->id, argc);
+        return ERR_NONE;
+      }
+    };
+
+  } // impl
+
+  template <typename T>
+    Program<T> Parser::compile(const char *s)
+    {
+      return compile<T>(s, s+strlen(s));
+    }
+  template <typename T>
+    Program<T> Parser::compile(const char *begin, const char *end)
+    {
+      Program<T> r;
+      auto e = shunt(begin, end,
+          [&r](const Sign &sign,
+            const std::pair<const char*, const char*> &p) {
+            r.push_constant(to_operand<T>(sign, p));
+            return ERR_NONE;
+          },
+          [&r](const std::pair<const char*, const char*> &, uint16_t slot) {
+            r.push_variable(slot);
+            return ERR_NONE;
+          },
+          [&r](const Operator *op, unsigned argc,
+            const std::pair<const char*, const char*> &) {
+            if (argc > UINT8_MAX)
+              throw std::overflow_error("too many function arguments");
+            r.push_operator(op->id, argc);
+            return ERR_NONE;
+          });
+      if (e)
+        e.raise();
+      return r;
+    }
+  template <typename T>
+    Parse_Error Parser::try_compile(const char *begin, const char *end,
+        Program<T> &r)
+    {
+      r.clear();
+      impl::Try_Compile<T> c{r};
+      return shunt(begin, end, c, c, c);
+    }
+
+} // syard
+
+#endif // SYARD_PROGRAM_HH
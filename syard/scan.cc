@@ -0,0 +1,192 @@
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "scan.hh"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define SYARD_SCAN_X86 1
+  #include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace syard {
+
+  static const char *scalar_space(const char *begin, const char *end)
+  {
+    return find_if_not(begin, end, is_space);
+  }
+  static const char *scalar_number(const char *begin, const char *end)
+  {
+    return find_if_not(begin, end, is_number);
+  }
+  static const char *scalar_name(const char *begin, const char *end)
+  {
+    return find_if_not(begin, end, is_name);
+  }
+  static const Scan_Kernels scalar_kernels = {
+    scalar_space, scalar_number, scalar_name
+  };
+
+#if SYARD_SCAN_X86
+
+  // Each class provides a SSE2 and an AVX2 version of match(), i.e. a
+  // byte mask that is set for bytes that are part of the class.
+  // Since SSE2/AVX2 only have signed byte comparisons, ranges are tested
+  // via cmpgt(c, lo-1) & cmpgt(hi+1, c) - non-ASCII bytes are negative
+  // and thus never match.
+  struct Space_Class {
+    static bool test(char c) { return is_space(c); }
+    __attribute__((target("sse2")))
+    static __m128i match(__m128i v)
+    {
+      return _mm_or_si128(
+          _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                       _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+          _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                       _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+    }
+    __attribute__((target("avx2")))
+    static __m256i match(__m256i v)
+    {
+      return _mm256_or_si256(
+          _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                          _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+          _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                          _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+    }
+  };
+  struct Number_Class {
+    static bool test(char c) { return is_number(c); }
+    __attribute__((target("sse2")))
+    static __m128i match(__m128i v)
+    {
+      return _mm_or_si128(
+          _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                        _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), v)),
+          _mm_cmpeq_epi8(v, _mm_set1_epi8('.')));
+    }
+    __attribute__((target("avx2")))
+    static __m256i match(__m256i v)
+    {
+      return _mm256_or_si256(
+          _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+                           _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v)),
+          _mm256_cmpeq_epi8(v, _mm256_set1_epi8('.')));
+    }
+  };
+  struct Name_Class {
+    static bool test(char c) { return is_name(c); }
+    __attribute__((target("sse2")))
+    static __m128i match(__m128i v)
+    {
+      return _mm_or_si128(
+          _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('a' - 1)),
+                        _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), v)),
+          _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    }
+    __attribute__((target("avx2")))
+    static __m256i match(__m256i v)
+    {
+      return _mm256_or_si256(
+          _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('a' - 1)),
+                           _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), v)),
+          _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+    }
+  };
+
+  // i.e. also without -msse2 on i386
+  template <typename C>
+    __attribute__((target("sse2")))
+    static const char *sse2_scan(const char *begin, const char *end)
+    {
+      for ( ; end - begin >= 16; begin += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        unsigned m = ~_mm_movemask_epi8(C::match(v)) & 0xffffu;
+        if (m)
+          return begin + __builtin_ctz(m);
+      }
+      return find_if_not(begin, end, C::test);
+    }
+  template <typename C>
+    __attribute__((target("avx2")))
+    static const char *avx2_scan(const char *begin, const char *end)
+    {
+      for ( ; end - begin >= 32; begin += 32) {
+        __m256i v = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(begin));
+        unsigned m = ~unsigned(_mm256_movemask_epi8(C::match(v)));
+        if (m)
+          return begin + __builtin_ctz(m);
+      }
+      return sse2_scan<C>(begin, end);
+    }
+
+  static const Scan_Kernels sse2_kernels = {
+    sse2_scan<Space_Class>, sse2_scan<Number_Class>, sse2_scan<Name_Class>
+  };
+  static const Scan_Kernels avx2_kernels = {
+    avx2_scan<Space_Class>, avx2_scan<Number_Class>, avx2_scan<Name_Class>
+  };
+
+#endif // SYARD_SCAN_X86
+
+  const Scan_Kernels *scan_kernels(Scan_Isa isa)
+  {
+#if SYARD_SCAN_X86
+    // might be called during static initialization
+    __builtin_cpu_init();
+#endif
+    switch (isa) {
+      case SCAN_SCALAR:
+        return &scalar_kernels;
+#if SYARD_SCAN_X86
+      case SCAN_SSE2:
+        return __builtin_cpu_supports("sse2") ? &sse2_kernels : nullptr;
+      case SCAN_AVX2:
+        return __builtin_cpu_supports("avx2") ? &avx2_kernels : nullptr;
+#endif
+      default:
+        return nullptr;
+    }
+  }
+  Scan_Isa best_scan_isa()
+  {
+    if (scan_kernels(SCAN_AVX2))
+      return SCAN_AVX2;
+    if (scan_kernels(SCAN_SSE2))
+      return SCAN_SSE2;
+    return SCAN_SCALAR;
+  }
+  void select_scan_isa(Scan_Isa isa)
+  {
+    auto k = scan_kernels(isa);
+    scan = k ? k : &scalar_kernels;
+  }
+
+  // constant initialized, thus usable during static initialization
+  // before the dispatch below has run
+  const Scan_Kernels *scan = &scalar_kernels;
+  static const bool scan_dispatched = (select_scan_isa(best_scan_isa()),
+      true);
+
+} // syard
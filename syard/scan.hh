@@ -0,0 +1,90 @@
+#ifndef SYARD_SCAN_HH
+#define SYARD_SCAN_HH
+
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+
+namespace syard {
+
+  // Character class scanners used by the lexer, each returns the first
+  // position in [begin, end) that isn't part of the class.
+  struct Scan_Kernels {
+    // [ \t\n\r]
+    const char *(*space)(const char *begin, const char *end);
+    // [0-9.]
+    const char *(*number)(const char *begin, const char *end);
+    // [a-z_]
+    const char *(*name)(const char *begin, const char *end);
+  };
+
+  enum Scan_Isa { SCAN_SCALAR, SCAN_SSE2, SCAN_AVX2 };
+
+  // returns nullptr if the ISA isn't supported by the CPU (or the build)
+  const Scan_Kernels *scan_kernels(Scan_Isa isa);
+  Scan_Isa best_scan_isa();
+  // the kernels used by the lexer default to best_scan_isa(),
+  // not thread-safe, i.e. meant for testing and benchmarking
+  void select_scan_isa(Scan_Isa isa);
+  extern const Scan_Kernels *scan;
+
+  inline bool is_space(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+  }
+  constexpr bool is_number(char c)
+  {
+    return (c >= '0' && c <= '9') || c == '.';
+  }
+  constexpr bool is_name(char c)
+  {
+    return (c >= 'a' && c <= 'z') || c == '_';
+  }
+
+  // most tokens are short, thus only dispatch to the vectorized kernels
+  // when the class extends beyond the first two bytes
+  inline const char *skip_space(const char *begin, const char *end)
+  {
+    if (begin == end || !is_space(*begin))
+      return begin;
+    if (++begin == end || !is_space(*begin))
+      return begin;
+    return scan->space(begin, end);
+  }
+  inline const char *scan_number(const char *begin, const char *end)
+  {
+    if (begin == end || !is_number(*begin))
+      return begin;
+    if (++begin == end || !is_number(*begin))
+      return begin;
+    return scan->number(begin, end);
+  }
+  inline const char *scan_name(const char *begin, const char *end)
+  {
+    if (begin == end || !is_name(*begin))
+      return begin;
+    if (++begin == end || !is_name(*begin))
+      return begin;
+    return scan->name(begin, end);
+  }
+
+} // syard
+
+#endif // SYARD_SCAN_HH
@@ -0,0 +1,136 @@
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "serialize.hh"
+
+#include <errno.h>
+#include <stdio.h>
+#include <system_error>
+
+using namespace std;
+
+namespace syard {
+
+  namespace impl {
+
+    static const char magic[6] = { 's', 'y', 'a', 'r', 'd', 0 };
+
+    File_Header file_header(uint32_t type, const Grammar &g,
+        size_t programs)
+    {
+      File_Header h;
+      memcpy(h.magic, magic, sizeof magic);
+      h.byte_order  = 0x0102;
+      h.version     = FORMAT_VERSION;
+      h.type        = type;
+      h.fingerprint = g.fingerprint();
+      h.programs    = programs;
+      h.variables   = g.symbol_table().size();
+      return h;
+    }
+
+    const uint64_t *check_header(const char *begin, const char *end,
+        uint32_t type, const Grammar &g)
+    {
+      File_Header h;
+      size_t n = end - begin;
+      if (n < sizeof h || memcmp(begin, magic, sizeof magic))
+        throw runtime_error("not a program file");
+      if (reinterpret_cast<uintptr_t>(begin) % 8)
+        throw invalid_argument("program file isn't 8 byte aligned");
+      memcpy(&h, begin, sizeof h);
+      if (h.byte_order != 0x0102)
+        throw runtime_error("program file has a different byte order");
+      if (h.version != FORMAT_VERSION)
+        throw runtime_error("unsupported program file version: "
+            + to_string(h.version));
+      if (h.type != type)
+        throw runtime_error("program file has a different operand type");
+      if (h.fingerprint != g.fingerprint())
+        throw runtime_error("program file was saved for another grammar");
+      if (h.programs >= (n - sizeof h) / sizeof(uint64_t))
+        throw runtime_error("truncated program file");
+      auto offsets = reinterpret_cast<const uint64_t*>(begin + sizeof h);
+      uint64_t last = sizeof h + (h.programs + 1) * sizeof(uint64_t);
+      for (size_t i = 0; i <= h.programs; ++i) {
+        if (offsets[i] < last || offsets[i] > n || offsets[i] % 8)
+          throw runtime_error("malformed program file offsets");
+        last = offsets[i];
+      }
+      return offsets;
+    }
+
+    size_t check_names(const char *begin, const char *end,
+        size_t variables, const Symbol_Table &symbols)
+    {
+      if (variables > size_t(end - begin) / sizeof(uint32_t))
+        throw runtime_error("truncated program file");
+      auto ends = reinterpret_cast<const uint32_t*>(begin);
+      auto chars = begin + variables * sizeof(uint32_t);
+      size_t b = 0;
+      for (size_t i = 0; i < variables; ++i) {
+        size_t e = ends[i];
+        if (e < b || e > size_t(end - chars))
+          throw runtime_error("malformed program file names");
+        if (symbols.find(make_pair(chars + b, chars + e)) != int(i))
+          throw runtime_error("variable slots differ from the grammar: "
+              + string(chars + b, chars + e));
+        b = e;
+      }
+      return variables;
+    }
+
+    size_t check_code(const Instruction *code, size_t n, size_t constants,
+        size_t variables)
+    {
+      size_t depth = 0;
+      size_t max_depth = 0;
+      for (size_t i = 0; i < n; ++i) {
+        auto &x = code[i];
+        if (x.code == OPERAND || x.code == VARIABLE) {
+          if (x.code == OPERAND ? x.arg >= constants : x.arg >= variables)
+            throw runtime_error("malformed program instruction");
+          ++depth;
+        } else {
+          if ((x.code < FIRST_ID && (x.code != NEGATE || x.argc != 1))
+              || x.argc > depth)
+            throw runtime_error("malformed program instruction");
+          depth = depth - x.argc + 1;
+        }
+        max_depth = max(max_depth, depth);
+      }
+      return max_depth;
+    }
+
+    void write_file(const char *filename, const string &s)
+    {
+      FILE *f = fopen(filename, "wb");
+      if (!f)
+        throw system_error(errno, system_category(), filename);
+      size_t n = fwrite(s.data(), 1, s.size(), f);
+      int e = errno;
+      if (fclose(f) || n != s.size())
+        throw system_error(n != s.size() ? e : errno, system_category(),
+            filename);
+    }
+
+  } // impl
+
+} // syard
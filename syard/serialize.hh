@@ -0,0 +1,282 @@
+#ifndef SYARD_SERIALIZE_HH
+#define SYARD_SERIALIZE_HH
+
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+
+#include "program.hh"
+#include "stream.hh"
+#include "syard.hh"
+
+#include <memory>
+#include <stddef.h>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace syard {
+
+  // File format (native byte order, all sections 8 byte aligned):
+  //
+  //     File_Header
+  //     uint64_t offsets[programs + 1]   i.e. of the records, the last one
+  //                                      is the offset of the name table
+  //     records:  Record_Header, Instruction[code], padding, T[constants]
+  //     names:    uint32_t ends[variables], chars
+  //
+  // The names are the variable names of the slots 0..variables-1 at
+  // save time.
+  enum { FORMAT_VERSION = 1 };
+
+  namespace impl {
+
+    struct File_Header {
+      char     magic[6];
+      uint16_t byte_order;  // i.e. 0x0102
+      uint32_t version;
+      uint32_t type;        // cf. Operand_Type
+      uint64_t fingerprint; // cf. Grammar::fingerprint()
+      uint64_t programs;
+      uint64_t variables;
+    };
+    struct Record_Header {
+      uint32_t code;
+      uint32_t constants;
+      uint32_t max_depth;
+      uint32_t variables;
+    };
+
+    // only trivially copyable operands can be used in place
+    template <typename T> struct Operand_Type;
+    template <> struct Operand_Type<int64_t> { enum { value = 1 }; };
+    template <> struct Operand_Type<double>  { enum { value = 2 }; };
+
+    inline size_t align8(size_t n) { return (n + 7) & ~size_t(7); }
+
+    File_Header file_header(uint32_t type, const Grammar &g,
+        size_t programs);
+    // throws runtime_error for a malformed or mismatching header and
+    // returns the offsets
+    const uint64_t *check_header(const char *begin, const char *end,
+        uint32_t type, const Grammar &g);
+    // i.e. the name table, returns the number of names
+    size_t check_names(const char *begin, const char *end,
+        size_t variables, const Symbol_Table &symbols);
+    // verifies the operand indices and the stack discipline, returns
+    // the max depth
+    size_t check_code(const Instruction *code, size_t n, size_t constants,
+        size_t variables);
+    void write_file(const char *filename, const std::string &s);
+
+  } // impl
+
+  // Serializes programs compiled against g, cf. Program_File.
+  template <typename T>
+    std::string serialize(const Grammar &g,
+        const std::vector<Program<T> > &ps);
+  // throws system_error
+  template <typename T>
+    void save(const char *filename, const Grammar &g,
+        const std::vector<Program<T> > &ps);
+
+  // a read-only array in place
+  template <typename T>
+  class Span {
+    private:
+      const T *begin_ {nullptr};
+      const T *end_ {nullptr};
+    public:
+      Span() =default;
+      Span(const T *begin, const T *end) : begin_(begin), end_(end) {}
+      const T *data() const { return begin_; }
+      size_t size() const { return end_ - begin_; }
+      bool empty() const { return begin_ == end_; }
+      const T *begin() const { return begin_; }
+      const T *end() const { return end_; }
+      const T &operator[](size_t i) const { return begin_[i]; }
+  };
+
+  // A program whose instructions and constants point into a
+  // Program_File, i.e. it can be run by the Evaluator (and the
+  // Batch_Evaluator) like a Program.
+  template <typename T>
+  class Program_View {
+    private:
+      Span<Instruction> code_;
+      Span<T> constants_;
+      size_t max_depth_ {0};
+      size_t variables_ {0};
+    public:
+      Program_View() =default;
+      Program_View(Span<Instruction> code, Span<T> constants,
+          size_t max_depth, size_t variables)
+        : code_(code), constants_(constants), max_depth_(max_depth),
+          variables_(variables)
+      {
+      }
+      const Span<Instruction> &code() const { return code_; }
+      const Span<T> &constants() const { return constants_; }
+      size_t max_depth() const { return max_depth_; }
+      size_t variables() const { return variables_; }
+      bool empty() const { return code_.empty(); }
+  };
+
+  // Loads programs written by save(), i.e. without parsing and without
+  // copying the instructions and constants of a memory-mapped file.
+  //
+  // The file is rejected (with a runtime_error) unless it was written
+  // for the same operand type, the same format version and a grammar
+  // with the same operators and functions (cf. Grammar::fingerprint())
+  // and the variable names map to the same slots in the symbol table of
+  // g. The records are validated, thus even a corrupted file can't make
+  // the Evaluator read out of bounds.
+  template <typename T>
+  class Program_File {
+    private:
+      std::unique_ptr<Mapped_File> file_;
+      std::vector<Program_View<T> > programs_;
+      size_t variables_ {0};
+
+      void load(const char *begin, const char *end, const Grammar &g);
+    public:
+      // throws system_error for I/O errors
+      Program_File(const char *filename, const Grammar &g);
+      // i.e. from a buffer that outlives this object, must be 8 byte
+      // aligned
+      Program_File(const char *begin, const char *end, const Grammar &g);
+
+      size_t size() const { return programs_.size(); }
+      const Program_View<T> &operator[](size_t i) const
+      {
+        return programs_[i];
+      }
+      typename std::vector<Program_View<T> >::const_iterator begin() const
+      {
+        return programs_.begin();
+      }
+      typename std::vector<Program_View<T> >::const_iterator end() const
+      {
+        return programs_.end();
+      }
+      // i.e. the number of named variable slots
+      size_t variables() const { return variables_; }
+  };
+
+  template <typename T>
+    std::string serialize(const Grammar &g,
+        const std::vector<Program<T> > &ps)
+    {
+      using namespace impl;
+      auto &symbols = g.symbol_table();
+      std::string s;
+      auto h = file_header(Operand_Type<T>::value, g, ps.size());
+      s.append(reinterpret_cast<const char*>(&h), sizeof h);
+      size_t offsets = s.size();
+      s.resize(s.size() + (ps.size() + 1) * sizeof(uint64_t));
+      auto set_offset = [&s, offsets](size_t i) {
+        uint64_t o = s.size();
+        memcpy(&s[offsets + i * sizeof o], &o, sizeof o);
+      };
+      for (size_t i = 0; i < ps.size(); ++i) {
+        auto &p = ps[i];
+        if (p.variables() > symbols.size())
+          throw std::invalid_argument("program references unknown slots");
+        set_offset(i);
+        Record_Header r { uint32_t(p.code().size()),
+          uint32_t(p.constants().size()), uint32_t(p.max_depth()),
+          uint32_t(p.variables()) };
+        s.append(reinterpret_cast<const char*>(&r), sizeof r);
+        s.append(reinterpret_cast<const char*>(p.code().data()),
+            p.code().size() * sizeof(Instruction));
+        s.resize(align8(s.size()));
+        s.append(reinterpret_cast<const char*>(p.constants().data()),
+            p.constants().size() * sizeof(T));
+      }
+      set_offset(ps.size());
+      std::string names;
+      for (size_t i = 0; i < symbols.size(); ++i) {
+        names += symbols.name(i);
+        uint32_t e = names.size();
+        s.append(reinterpret_cast<const char*>(&e), sizeof e);
+      }
+      s += names;
+      s.resize(align8(s.size()));
+      return s;
+    }
+  template <typename T>
+    void save(const char *filename, const Grammar &g,
+        const std::vector<Program<T> > &ps)
+    {
+      impl::write_file(filename, serialize(g, ps));
+    }
+
+  template <typename T>
+    Program_File<T>::Program_File(const char *filename, const Grammar &g)
+      : file_(new Mapped_File(filename))
+    {
+      load(file_->begin(), file_->end(), g);
+    }
+  template <typename T>
+    Program_File<T>::Program_File(const char *begin, const char *end,
+        const Grammar &g)
+    {
+      load(begin, end, g);
+    }
+  template <typename T>
+    void Program_File<T>::load(const char *begin, const char *end,
+        const Grammar &g)
+    {
+      using namespace impl;
+      auto offsets = check_header(begin, end, Operand_Type<T>::value, g);
+      size_t n = reinterpret_cast<const File_Header*>(begin)->programs;
+      programs_.reserve(n);
+      for (size_t i = 0; i < n; ++i) {
+        auto p = begin + offsets[i];
+        auto q = begin + offsets[i + 1];
+        Record_Header r;
+        if (size_t(q - p) < sizeof r)
+          throw std::runtime_error("truncated program record");
+        memcpy(&r, p, sizeof r);
+        auto code = reinterpret_cast<const Instruction*>(p + sizeof r);
+        auto c = p + align8(sizeof r + size_t(r.code) * sizeof(Instruction));
+        if (c > q || size_t(q - c) != size_t(r.constants) * sizeof(T))
+          throw std::runtime_error("malformed program record");
+        auto constants = reinterpret_cast<const T*>(c);
+        if (check_code(code, r.code, r.constants, r.variables)
+            != r.max_depth)
+          throw std::runtime_error("malformed program record");
+        programs_.emplace_back(Span<Instruction>(code, code + r.code),
+            Span<T>(constants, constants + r.constants), r.max_depth,
+            r.variables);
+      }
+      variables_ = check_names(begin + offsets[n], end,
+          reinterpret_cast<const File_Header*>(begin)->variables,
+          g.symbol_table());
+      for (auto &p : programs_)
+        if (p.variables() > variables_)
+          throw std::runtime_error("malformed program record");
+    }
+
+} // syard
+
+#endif // SYARD_SERIALIZE_HH
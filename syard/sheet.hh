@@ -0,0 +1,332 @@
+#ifndef SYARD_SHEET_HH
+#define SYARD_SHEET_HH
+
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+
+#include "eval.hh"
+#include "program.hh"
+#include "syard.hh"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <stddef.h>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace syard {
+
+  struct Sheet_Stats {
+    // calls of recompute()
+    size_t recomputes {0};
+    // formula evaluations, in total and by the last recompute()
+    size_t evaluated {0};
+    size_t last {0};
+    // i.e. of input values, by set()
+    size_t updates {0};
+  };
+
+  // Named cells that are either inputs or formulas over other cells,
+  // i.e. a spreadsheet without the grid.
+  //
+  // The cells are the variables of the parser's symbol table, thus a
+  // compiled formula reads the other cells directly. Updates are
+  // batched, i.e. set() only marks the dependent formulas as dirty and
+  // recompute() evaluates the dirty cone in topological order. A formula
+  // whose value doesn't change doesn't dirty its dependents. Formulas
+  // that call impure functions (cf. Evaluator::insert()) are evaluated
+  // on each recompute().
+  template <typename T>
+  class Sheet {
+    private:
+      struct Cell {
+        Program<T> program;
+        // i.e. the cells the formula reads
+        std::vector<uint16_t> deps;
+        std::vector<uint16_t> users;
+        // the functions the formula calls
+        std::vector<uint8_t> functions;
+        uint32_t rank {0};
+        bool formula {false};
+        bool volatile_ {false};
+        bool queued {false};
+      };
+      Parser parser_;
+      Evaluator<T> evaluator_;
+      std::vector<Cell> cells_;
+      std::vector<T> values_;
+      // i.e. to be evaluated by the next recompute()
+      std::vector<uint16_t> dirty_;
+      std::vector<uint16_t> volatile_;
+      bool ranked_ {true};
+      Sheet_Stats stats_;
+
+      uint16_t cell(const char *begin, const char *end);
+      void mark_users(uint16_t slot);
+      void mark(uint16_t slot);
+      bool reaches(uint16_t from, uint16_t to) const;
+      void rank();
+    public:
+      // e.g. for inserting operators and functions, before defining
+      // formulas that use them
+      Parser &parser() { return parser_; }
+      Evaluator<T> &evaluator() { return evaluator_; }
+
+      // (re-)defines name as formula, names that aren't defined, yet,
+      // become inputs, throws on parse errors and cyclic references
+      void define(const char *name, const char *expr);
+      // an input cell, throws for formulas
+      void set(const char *name, T v);
+      void set(uint16_t slot, T v);
+      // i.e. after function id changed its behavior
+      void touch(uint8_t function);
+      // evaluates the dirty formulas, on error the remaining ones stay
+      // dirty
+      void recompute();
+
+      // throws for unknown names
+      uint16_t slot(const char *name) const;
+      const T &get(const char *name) const;
+      const T &get(uint16_t slot) const { return values_.at(slot); }
+      // i.e. the cells the formula reads and the functions it calls
+      const std::vector<uint16_t> &deps(uint16_t slot) const
+      { return cells_.at(slot).deps; }
+      const std::vector<uint8_t> &functions(uint16_t slot) const
+      { return cells_.at(slot).functions; }
+      const Sheet_Stats &stats() const { return stats_; }
+  };
+
+  template <typename T>
+    uint16_t Sheet<T>::cell(const char *begin, const char *end)
+    {
+      uint16_t r = parser_.symbol_table().insert(begin, end);
+      if (r >= cells_.size()) {
+        cells_.resize(r + 1);
+        values_.resize(r + 1);
+      }
+      return r;
+    }
+  template <typename T>
+    uint16_t Sheet<T>::slot(const char *name) const
+    {
+      int r = parser_.grammar().symbol_table().find(
+          std::make_pair(name, name + strlen(name)));
+      if (r < 0)
+        throw std::range_error("unknown cell: " + std::string(name));
+      return r;
+    }
+  template <typename T>
+    const T &Sheet<T>::get(const char *name) const
+    {
+      return values_[slot(name)];
+    }
+
+  // i.e. whether `to` depends on `from`
+  template <typename T>
+    bool Sheet<T>::reaches(uint16_t from, uint16_t to) const
+    {
+      std::vector<uint16_t> todo(1, from);
+      std::vector<bool> seen(cells_.size());
+      while (!todo.empty()) {
+        uint16_t x = todo.back();
+        todo.pop_back();
+        if (x == to)
+          return true;
+        if (seen[x])
+          continue;
+        seen[x] = true;
+        for (auto u : cells_[x].users)
+          todo.push_back(u);
+      }
+      return false;
+    }
+
+  template <typename T>
+    void Sheet<T>::define(const char *name, const char *expr)
+    {
+      uint16_t x = cell(name, name + strlen(name));
+      auto end = expr + strlen(expr);
+      Program<T> p;
+      // i.e. unknown names are inputs
+      for (;;) {
+        auto e = parser_.try_compile(expr, end, p);
+        if (!e)
+          break;
+        if (e.code != ERR_UNKNOWN_NAME)
+          e.raise();
+        cell(e.token.first, e.token.second);
+      }
+      std::vector<uint16_t> deps;
+      std::vector<uint8_t> functions;
+      for (auto &i : p.code()) {
+        if (i.code == VARIABLE)
+          deps.push_back(i.arg);
+        else if (i.code >= FIRST_ID && !evaluator_.builtin(i.code))
+          functions.push_back(i.code);
+      }
+      std::sort(deps.begin(), deps.end());
+      deps.erase(std::unique(deps.begin(), deps.end()), deps.end());
+      std::sort(functions.begin(), functions.end());
+      functions.erase(std::unique(functions.begin(), functions.end()),
+          functions.end());
+      for (auto d : deps)
+        if (d == x || reaches(x, d))
+          throw std::invalid_argument("cyclic reference: "
+              + std::string(name));
+
+      auto &c = cells_[x];
+      for (auto d : c.deps) {
+        auto &u = cells_[d].users;
+        u.erase(std::find(u.begin(), u.end(), x));
+      }
+      for (auto d : deps)
+        cells_[d].users.push_back(x);
+      c.program = std::move(p);
+      c.deps = std::move(deps);
+      c.functions = std::move(functions);
+      c.formula = true;
+      bool v = false;
+      for (auto f : c.functions)
+        v = v || !evaluator_.pure(f);
+      if (v && !c.volatile_)
+        volatile_.push_back(x);
+      else if (!v && c.volatile_)
+        volatile_.erase(std::find(volatile_.begin(), volatile_.end(), x));
+      c.volatile_ = v;
+      ranked_ = false;
+      mark(x);
+    }
+
+  template <typename T>
+    void Sheet<T>::mark(uint16_t slot)
+    {
+      auto &c = cells_[slot];
+      if (!c.queued) {
+        c.queued = true;
+        dirty_.push_back(slot);
+      }
+    }
+  template <typename T>
+    void Sheet<T>::mark_users(uint16_t slot)
+    {
+      for (auto u : cells_[slot].users)
+        mark(u);
+    }
+
+  template <typename T>
+    void Sheet<T>::set(const char *name, T v)
+    {
+      set(cell(name, name + strlen(name)), std::move(v));
+    }
+  template <typename T>
+    void Sheet<T>::set(uint16_t slot, T v)
+    {
+      if (cells_.at(slot).formula)
+        throw std::logic_error("cell is a formula");
+      ++stats_.updates;
+      if (values_[slot] == v)
+        return;
+      values_[slot] = std::move(v);
+      mark_users(slot);
+    }
+  template <typename T>
+    void Sheet<T>::touch(uint8_t function)
+    {
+      for (size_t i = 0; i < cells_.size(); ++i) {
+        auto &f = cells_[i].functions;
+        if (std::binary_search(f.begin(), f.end(), function))
+          mark(i);
+      }
+    }
+
+  // i.e. a formula's rank is greater than the ranks of its deps
+  template <typename T>
+    void Sheet<T>::rank()
+    {
+      std::vector<uint32_t> pending(cells_.size());
+      std::vector<uint16_t> todo;
+      for (size_t i = 0; i < cells_.size(); ++i) {
+        pending[i] = cells_[i].deps.size();
+        cells_[i].rank = 0;
+        if (!pending[i])
+          todo.push_back(i);
+      }
+      while (!todo.empty()) {
+        uint16_t x = todo.back();
+        todo.pop_back();
+        for (auto u : cells_[x].users) {
+          cells_[u].rank = std::max(cells_[u].rank, cells_[x].rank + 1);
+          if (!--pending[u])
+            todo.push_back(u);
+        }
+      }
+      ranked_ = true;
+    }
+
+  template <typename T>
+    void Sheet<T>::recompute()
+    {
+      if (!ranked_)
+        rank();
+      ++stats_.recomputes;
+      stats_.last = 0;
+      for (auto x : volatile_)
+        mark(x);
+      using Item = std::pair<uint32_t, uint16_t>;
+      std::priority_queue<Item, std::vector<Item>, std::greater<Item> > q;
+      for (auto x : dirty_)
+        q.push(Item(cells_[x].rank, x));
+      dirty_.clear();
+      uint16_t x = 0;
+      try {
+        while (!q.empty()) {
+          x = q.top().second;
+          q.pop();
+          auto &c = cells_[x];
+          T v = evaluator_.run(c.program, values_.data());
+          c.queued = false;
+          ++stats_.last;
+          ++stats_.evaluated;
+          if (v == values_[x])
+            continue;
+          values_[x] = std::move(v);
+          for (auto u : c.users)
+            if (!cells_[u].queued) {
+              cells_[u].queued = true;
+              q.push(Item(cells_[u].rank, u));
+            }
+        }
+      } catch (...) {
+        dirty_.push_back(x);
+        for ( ; !q.empty(); q.pop())
+          dirty_.push_back(q.top().second);
+        throw;
+      }
+    }
+
+} // syard
+
+#endif // SYARD_SHEET_HH
@@ -0,0 +1,308 @@
+#ifndef SYARD_STATIC_GRAMMAR_HH
+#define SYARD_STATIC_GRAMMAR_HH
+
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+
+#include "program.hh"
+#include "scan.hh"
+#include "syard.hh"
+
+#include <initializer_list>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <utility>
+
+namespace syard {
+
+  // An operator of a Static_Grammar, Cs are its bytes, e.g.
+  // Static_Operator<POWER, 10, false, false, '*', '*'>.
+  template <uint8_t Id, uint8_t Precedence, bool Left_Associative,
+           bool Sign_Overload, char... Cs>
+  struct Static_Operator {
+    static_assert(sizeof...(Cs) && sizeof...(Cs) <= MAX_OPERATOR_SIZE,
+        "operator size out of range");
+    enum { size = sizeof...(Cs) };
+    static constexpr char chars[] = { Cs... };
+    static constexpr Operator op {Id, Precedence, Left_Associative, false,
+      Sign_Overload};
+
+    static bool match(const char *begin, const char *end)
+    {
+      if (size_t(end - begin) < size)
+        return false;
+      for (size_t i = 0; i < size; ++i)
+        if (begin[i] != chars[i])
+          return false;
+      return true;
+    }
+  };
+  template <uint8_t Id, uint8_t Precedence, bool Left_Associative,
+           bool Sign_Overload, char... Cs>
+    constexpr char Static_Operator<Id, Precedence, Left_Associative,
+              Sign_Overload, Cs...>::chars[];
+  template <uint8_t Id, uint8_t Precedence, bool Left_Associative,
+           bool Sign_Overload, char... Cs>
+    constexpr Operator Static_Operator<Id, Precedence, Left_Associative,
+              Sign_Overload, Cs...>::op;
+
+  // e.g. Static_Function_Arity<20, 1, Function_Table::VARIADIC, 'm', 'a',
+  // 'x'>, cf. Function_Table::insert()
+  template <uint8_t Id, uint8_t Min_Arity, uint8_t Max_Arity, char... Cs>
+  struct Static_Function_Arity {
+    static_assert(sizeof...(Cs) && sizeof...(Cs) < MAX_FUNCTION_SIZE,
+        "function name size out of range");
+    static_assert(Min_Arity <= Max_Arity, "min arity exceeds max arity");
+    enum { size = sizeof...(Cs) };
+    static constexpr Operator op {Id, 0, true, true, false, Min_Arity,
+      Max_Arity};
+
+    static bool match(const char *begin, size_t n)
+    {
+      static constexpr char cs[] = { Cs... };
+      return n == size && !memcmp(begin, cs, size);
+    }
+  };
+  template <uint8_t Id, uint8_t Min_Arity, uint8_t Max_Arity, char... Cs>
+    constexpr Operator Static_Function_Arity<Id, Min_Arity, Max_Arity,
+              Cs...>::op;
+  // e.g. Static_Function<20, 'm', 'a', 'x'>, i.e. with any arity
+  template <uint8_t Id, char... Cs>
+    using Static_Function = Static_Function_Arity<Id, 0,
+          Function_Table::VARIADIC, Cs...>;
+
+  template <typename... Ts> struct Operators {};
+  template <typename... Ts> struct Functions {};
+
+  // i.e. Operator_Table::insert_default_arithmetic()
+  using Default_Arithmetic = Operators<
+    Static_Operator<POWER, 10, false, false, '^'>,
+    Static_Operator<POWER, 10, false, false, '*', '*'>,
+    Static_Operator<MULT ,  9, true , false, '*'>,
+    Static_Operator<DIV  ,  9, true , false, '/'>,
+    Static_Operator<PLUS ,  8, true , false, '+'>,
+    Static_Operator<MINUS,  8, true , true , '-'>
+    >;
+
+  namespace impl {
+
+    constexpr bool all_of(std::initializer_list<bool> l)
+    {
+      for (bool b : l)
+        if (!b)
+          return false;
+      return true;
+    }
+
+  } // impl
+
+  // A grammar whose operators and functions are fixed at compile time,
+  // e.g. Static_Grammar<Default_Arithmetic, Functions<...>>.
+  //
+  // In contrast to the tables of a Grammar nothing is built at runtime:
+  // the longest match over the operators and the function lookup are
+  // unrolled comparisons against immediates, i.e. they are inlined into
+  // the shunting-yard loop of a Static_Parser. Like with a Grammar,
+  // parens and the comma are always included.
+  template <typename Ops, typename Fns = Functions<> > class Static_Grammar;
+
+  template <typename... Os, typename... Fs>
+  class Static_Grammar<Operators<Os...>, Functions<Fs...> > {
+    private:
+      static_assert(impl::all_of({ (Os::op.id >= FIRST_ID)... }),
+          "operator id is reserved");
+      static_assert(impl::all_of({ (Fs::op.id >= FIRST_ID)... }),
+          "function id is reserved");
+      // i.e. numbers and names can be lexed without trying the operators
+      // first
+      static constexpr bool plain_operands = impl::all_of({
+          !(is_number(Os::chars[0]) || is_name(Os::chars[0]))... });
+
+      template <typename... Xs>
+        static Operator_Table::Result lex_operator(const char *begin,
+            const char *end, size_t *probes)
+        {
+          (void)probes;
+          SYARD_COUNT(probes && (*probes += sizeof...(Xs)));
+          const Operator *op = nullptr;
+          size_t n = 0;
+          // i.e. the longest match, the first one on ties
+          (void)std::initializer_list<int>{ (
+              Xs::size > n && Xs::match(begin, end)
+              ? (op = &Xs::op, n = Xs::size, 0) : 0)... };
+          return Operator_Table::Result(begin, begin + n,
+              op ? op->id : uint8_t(INVALID), op);
+        }
+    public:
+      // cf. Operator_Table::try_lex()
+      static Operator_Table::Result lex(const char *begin, const char *end,
+          size_t *probes = nullptr)
+      {
+        auto b = skip_space(begin, end);
+        if (b == end)
+          return Operator_Table::Result(end, end, EPSILON, nullptr);
+        if (!plain_operands || !(is_number(*b) || is_name(*b))) {
+          auto r = lex_operator<
+            Static_Operator<LEFT_PAREN , 0, true, false, '('>,
+            Static_Operator<RIGHT_PAREN, 0, true, false, ')'>,
+            Static_Operator<COMMA      , 0, true, false, ','>,
+            Os...>(b, end, probes);
+          if (r.op)
+            return r;
+        }
+        if (is_number(*b))
+          return Operator_Table::Result(b, scan_number(b, end), OPERAND,
+              nullptr);
+        else if (is_name(*b))
+          return Operator_Table::Result(b, scan_name(b, end), FUNCTION,
+              nullptr);
+        return Operator_Table::Result(b, b + 1, INVALID, nullptr);
+      }
+      // returns nullptr for unknown names
+      static const Operator *function(
+          const std::pair<const char*, const char*> &p)
+      {
+        const Operator *op = nullptr;
+        size_t n = p.second - p.first;
+        (void)n;
+        (void)std::initializer_list<int>{ (
+            !op && Fs::match(p.first, n) ? (op = &Fs::op, 0) : 0)... };
+        return op;
+      }
+  };
+
+  // Like Parser, but lexes with a Static_Grammar G, i.e. without
+  // building, sorting or probing any operator/function tables. The
+  // variables are still looked up in a (runtime) Symbol_Table.
+  template <typename G>
+  class Static_Parser {
+    private:
+      impl::Shunt_State state_;
+      Symbol_Table symbols_;
+
+      struct Lexer {
+        const Symbol_Table &symbols;
+
+        Operator_Table::Result lex(const char *begin, const char *end,
+            size_t *probes)
+        {
+          return G::lex(begin, end, probes);
+        }
+        const Operator *function(
+            const std::pair<const char*, const char*> &p) const
+        {
+          return G::function(p);
+        }
+        int variable(const std::pair<const char*, const char*> &p) const
+        {
+          return symbols.find(p);
+        }
+      };
+      template <typename O, typename V, typename F>
+        Parse_Error shunt(const char *begin, const char *end,
+            O o, V v, F f)
+        {
+          Lexer l{symbols_};
+          return impl::shunt(state_, l, begin, end, o, v, f);
+        }
+    public:
+      Symbol_Table &symbol_table() { return symbols_; }
+      const Symbol_Table &symbol_table() const { return symbols_; }
+
+      // cf. Parser::try_parse(), i.e. variables yield ERR_VARIABLE
+      template <typename T, typename F>
+        Parse_Error try_parse(const char *begin, const char *end,
+            Stack<T> &stack, F f);
+      template <typename T, typename F>
+        void parse(const char *begin, const char *end, Stack<T> &stack,
+            F f);
+      template <typename T, typename F>
+        void parse(const char *s, Stack<T> &stack, F f)
+        {
+          parse(s, s + strlen(s), stack, f);
+        }
+
+      // cf. Parser::try_compile()
+      template <typename T>
+        Parse_Error try_compile(const char *begin, const char *end,
+            Program<T> &p);
+      template <typename T>
+        Program<T> compile(const char *begin, const char *end);
+      template <typename T>
+        Program<T> compile(const char *s)
+        {
+          return compile<T>(s, s + strlen(s));
+        }
+
+      // only maintained when compiled with SYARD_STATS
+      const Parse_Stats &stats() const { return state_.stats; }
+      void reset_stats() { state_.stats = Parse_Stats(); }
+  };
+
+  template <typename G> template <typename T, typename F>
+    Parse_Error Static_Parser<G>::try_parse(const char *begin,
+        const char *end, Stack<T> &stack, F f)
+    {
+      return shunt(begin, end,
+          [&stack](const Sign &sign,
+            const std::pair<const char*, const char*> &p) {
+            T v;
+            auto e = try_to_operand<T>(sign, p, v);
+            if (!e)
+              stack.push(std::move(v));
+            return e;
+          },
+          [](const std::pair<const char*, const char*> &, uint16_t) {
+            return ERR_VARIABLE; },
+          [&f](const Operator *op, unsigned argc,
+            const std::pair<const char*, const char*> &) {
+            impl::emit(f, op->id, argc);
+            return ERR_NONE;
+          });
+    }
+  template <typename G> template <typename T, typename F>
+    void Static_Parser<G>::parse(const char *begin, const char *end,
+        Stack<T> &stack, F f)
+    {
+      if (auto e = try_parse(begin, end, stack, f))
+        e.raise();
+    }
+  template <typename G> template <typename T>
+    Parse_Error Static_Parser<G>::try_compile(const char *begin,
+        const char *end, Program<T> &r)
+    {
+      r.clear();
+      impl::Try_Compile<T> c{r};
+      return shunt(begin, end, c, c, c);
+    }
+  template <typename G> template <typename T>
+    Program<T> Static_Parser<G>::compile(const char *begin, const char *end)
+    {
+      Program<T> r;
+      if (auto e = try_compile(begin, end, r))
+        e.raise();
+      return r;
+    }
+
+} // syard
+
+#endif // SYARD_STATIC_GRAMMAR_HH
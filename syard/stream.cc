@@ -0,0 +1,65 @@
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "stream.hh"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+using namespace std;
+
+namespace syard {
+
+  Mapped_File::Mapped_File(const char *filename)
+  {
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1)
+      throw system_error(errno, system_category(), filename);
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+      int e = errno;
+      close(fd);
+      throw system_error(e, system_category(), filename);
+    }
+    size_ = st.st_size;
+    // i.e. mapping zero bytes fails
+    if (size_) {
+      void *p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p == MAP_FAILED) {
+        int e = errno;
+        close(fd);
+        throw system_error(e, system_category(), filename);
+      }
+      madvise(p, size_, MADV_SEQUENTIAL);
+      data_ = static_cast<const char*>(p);
+    }
+    close(fd);
+  }
+  Mapped_File::~Mapped_File()
+  {
+    if (data_)
+      munmap(const_cast<char*>(data_), size_);
+  }
+
+} // syard
@@ -0,0 +1,142 @@
+#ifndef SYARD_STREAM_HH
+#define SYARD_STREAM_HH
+
+// Copyright 2016, Georg Sauthoff <mail@georg.so>
+
+/* {{{ LGPLv3
+
+    This file is part of syard.
+
+    syard is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    syard is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with syard.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+
+#include "scan.hh"
+
+#include <memory>
+#include <stddef.h>
+#include <string>
+
+namespace syard {
+
+  // A read-only memory mapping of a whole file, throws system_error.
+  class Mapped_File {
+    private:
+      const char *data_ {nullptr};
+      size_t size_ {0};
+    public:
+      explicit Mapped_File(const char *filename);
+      ~Mapped_File();
+      Mapped_File(const Mapped_File &) =delete;
+      Mapped_File &operator=(const Mapped_File &) =delete;
+      const char *begin() const { return data_; }
+      const char *end() const { return data_ + size_; }
+      size_t size() const { return size_; }
+  };
+
+  // Splits a stream of newline or semicolon separated expressions that
+  // arrives in chunks, i.e. calls f(begin, end) for each expression
+  // that contains more than whitespace.
+  //
+  // Expressions are passed in place, i.e. without copying, unless they
+  // straddle a chunk boundary, then the head is carried over to the
+  // next chunk. The pointers are only valid during the call of f.
+  class Expression_Splitter {
+    private:
+      std::string carry_;
+      size_t bytes_ {0};
+      size_t expressions_ {0};
+
+      template <typename F> void emit(const char *begin, const char *end,
+          F &f);
+    public:
+      template <typename F> void feed(const char *begin, const char *end,
+          F f);
+      // i.e. the last expression, if it isn't terminated
+      template <typename F> void finish(F f);
+
+      // consumed so far
+      size_t bytes() const { return bytes_; }
+      size_t expressions() const { return expressions_; }
+  };
+
+  // i.e. for separators
+  inline const char *scan_line(const char *begin, const char *end)
+  {
+    for ( ; begin != end; ++begin)
+      if (*begin == '\n' || *begin == ';')
+        break;
+    return begin;
+  }
+
+  template <typename F>
+    void Expression_Splitter::emit(const char *begin, const char *end, F &f)
+    {
+      if (skip_space(begin, end) == end)
+        return;
+      ++expressions_;
+      f(begin, end);
+    }
+  template <typename F>
+    void Expression_Splitter::feed(const char *begin, const char *end, F f)
+    {
+      bytes_ += end - begin;
+      auto p = begin;
+      auto q = scan_line(p, end);
+      if (!carry_.empty()) {
+        carry_.append(p, q);
+        if (q == end)
+          return;
+        emit(carry_.data(), carry_.data() + carry_.size(), f);
+        carry_.clear();
+        p = q + 1;
+        q = scan_line(p, end);
+      }
+      while (q != end) {
+        emit(p, q, f);
+        p = q + 1;
+        q = scan_line(p, end);
+      }
+      carry_.assign(p, end);
+    }
+  template <typename F>
+    void Expression_Splitter::finish(F f)
+    {
+      emit(carry_.data(), carry_.data() + carry_.size(), f);
+      carry_.clear();
+    }
+
+  // splits the file, i.e. without any copying
+  template <typename F>
+    void split(const Mapped_File &m, F f)
+    {
+      Expression_Splitter s;
+      s.feed(m.begin(), m.end(), f);
+      s.finish(f);
+    }
+  // splits the chunks returned by read(buf, n), i.e. until it
+  // returns 0
+  template <typename R, typename F>
+    void split(R read, F f, size_t chunk = 64 * 1024)
+    {
+      std::unique_ptr<char[]> buf(new char[chunk]);
+      Expression_Splitter s;
+      while (size_t n = read(buf.get(), chunk))
+        s.feed(buf.get(), buf.get() + n, f);
+      s.finish(f);
+    }
+
+} // syard
+
+#endif // SYARD_STREAM_HH
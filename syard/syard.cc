@@ -19,11 +19,16 @@
 
 }}} */
 #include "syard.hh"
+#include "number.hh"
+#include "program.hh"
+#include "scan.hh"
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <functional>
 //#include <iostream>
+#include <iterator>
 #include <stdexcept>
 #include <string.h>
 #include <utility>
@@ -44,20 +49,78 @@ namespace syard {
   {
   }
 
-  Operator_Table::Result::Result(const char *begin, const char *end,
-      uint8_t id, Operator *op)
-    : p(begin, end), id(id), op(op)
-  {
-  }
   Operator_Table::Result::Result(
       const unsigned char *begin, const unsigned char *end,
-      uint8_t id, Operator *op)
+      uint8_t id, const Operator *op)
     : Result(reinterpret_cast<const char*>(begin),
         reinterpret_cast<const char *>(end), id, op)
   {
   }
 
+  const char *error_string(Error_Code c)
+  {
+    switch (c) {
+      case ERR_NONE               : return "no error";
+      case ERR_LEX                : return "no operator/operand to lex";
+      case ERR_UNKNOWN_NAME       : return "unknown function/variable";
+      case ERR_UNMATCHED_PAREN    : return "unmatched paren";
+      case ERR_UNMATCHED_ELEMENT  : return "unmatched element";
+      case ERR_UNEXPECTED_OPERATOR: return "unexpected operator";
+      case ERR_MALFORMED_NUMBER   : return "malformed number";
+      case ERR_NUMBER_RANGE       : return "number out of range";
+      case ERR_VARIABLE           : return "variable without value";
+      case ERR_MISSING_OPERAND    : return "not enough operands";
+      case ERR_LIMIT              : return "expression too large";
+      case ERR_ARITY              : return "wrong number of arguments";
+    }
+    return "unknown error";
+  }
+  string Parse_Error::message() const
+  {
+    string r(error_string(code));
+    switch (code) {
+      case ERR_UNKNOWN_NAME:
+      case ERR_MALFORMED_NUMBER:
+      case ERR_NUMBER_RANGE:
+      case ERR_VARIABLE:
+      case ERR_ARITY:
+        r += ": ";
+        r.append(token.first, token.second);
+        break;
+      default:
+        break;
+    }
+    return r;
+  }
+  void Parse_Error::raise() const
+  {
+    switch (code) {
+      case ERR_NONE:
+        throw logic_error("no error to raise");
+      case ERR_UNMATCHED_PAREN:
+      case ERR_UNMATCHED_ELEMENT:
+      case ERR_UNEXPECTED_OPERATOR:
+      case ERR_MISSING_OPERAND:
+        throw underflow_error(message());
+      case ERR_NUMBER_RANGE:
+      case ERR_LIMIT:
+        throw overflow_error(message());
+      case ERR_ARITY:
+        throw invalid_argument(message());
+      default:
+        throw range_error(message());
+    }
+  }
+
+  // i.e. the table versions are unique
+  static uint64_t next_version()
+  {
+    static atomic<uint64_t> n {0};
+    return ++n;
+  }
+
   Operator_Table::Operator_Table()
+    : version_(next_version())
   {
     table_.reserve(8);
   }
@@ -72,11 +135,20 @@ namespace syard {
       throw overflow_error("only supports operators up to "
           + to_string(MAX_OPERATOR_SIZE) + " chars");
 
+    for (auto p = begin; p + 1 < end; ++p) {
+      uint16_t x = uint16_t((unsigned char)p[0]) << 8 | (unsigned char)p[1];
+      auto i = lower_bound(pairs_.begin(), pairs_.end(), x);
+      if (i == pairs_.end() || *i != x)
+        pairs_.insert(i, x);
+    }
     table_.emplace_back();
     sorted_ = false;
+    version_ = next_version();
     auto &t = table_.back();
-    copy(begin, end, t.first.begin());
-    fill(t.first.begin() + (end-begin), t.first.end(), 0+0);
+    // i.e. bounded, as the compiler doesn't see the size check above
+    size_t n = min(size_t(end - begin), size_t(MAX_OPERATOR_SIZE));
+    t.first.fill(0);
+    memcpy(t.first.data(), begin, n);
     t.second.left_associative = left_associative;
     t.second.sign_overload = sign_overload;
     t.second.function = false;
@@ -87,8 +159,34 @@ namespace syard {
   {
     if (sorted_)
       return;
-    std::sort(table_.begin(), table_.end(), [](auto &a, auto &b) {
-        return a.first > b.first; });
+    if (table_.size() * MAX_OPERATOR_SIZE >= UINT16_MAX)
+      throw overflow_error("too many operators");
+    first_.fill(0);
+    nodes_.assign(1, Trie_Node());
+    // no reallocations, as we keep a pointer to the current link
+    nodes_.reserve(1 + table_.size() * MAX_OPERATOR_SIZE);
+    for (size_t i = 0; i < table_.size(); ++i) {
+      auto &k = table_[i].first;
+      auto e = find(k.begin(), k.end(), 0+0);
+      uint16_t *link = &first_[k[0]];
+      uint16_t n = 0;
+      for (auto c = k.begin(); c != e; ++c) {
+        for (n = *link; n && nodes_[n].byte != *c; n = nodes_[n].sibling)
+          ;
+        if (!n) {
+          n = nodes_.size();
+          nodes_.emplace_back();
+          nodes_.back().byte = *c;
+          // first_ already dispatches on the first byte
+          if (c != k.begin())
+            nodes_.back().sibling = *link;
+          *link = n;
+        }
+        link = &nodes_[n].child;
+      }
+      // later inserts override earlier ones
+      nodes_[n].op = i;
+    }
     sorted_ = true;
   }
   void Operator_Table::insert(char c, uint8_t id,
@@ -102,77 +200,96 @@ namespace syard {
     insert(s, s+strlen(s), id, precedence, left_associative, sign_overload);
   }
 
-  struct Op_Compare {
-    bool operator()(const pair<const unsigned char*, const unsigned char*> &a,
-        const std::pair<std::array<unsigned char, MAX_OPERATOR_SIZE>,
-                        Operator> &b) const
-    {
-      bool r = lexicographical_compare(
-          a.first, min(a.first + b.first.size(), a.second),
-          b.first.begin(), b.first.end(), std::greater<unsigned char>());
-      return r;
-    }
-    bool operator()(
-        const std::pair<std::array<unsigned char, MAX_OPERATOR_SIZE>,
-                        Operator> &a,
-        const pair<const unsigned char*, const unsigned char*> &b) const
-    {
-      bool r = lexicographical_compare(
-          a.first.begin(), a.first.end(),
-          b.first, min(b.first + a.first.size(), b.second),
-          std::greater<char>());
-      return r;
-    }
-  };
-
-  template <typename I1, typename I2>
-    I1 common_prefix(I1 b1, I1 e1, I2 b2, I2 e2)
-    {
-      for ( ; b1 != e1 && b2 != e2; ++b1, ++b2)
-        if (*b1 != *b2)
-          break;
-      return b1;
-    }
-
   // we operate (i.e. compare) unsigned bytes to be able to deal with utf8
   // strings
   Operator_Table::Result Operator_Table::lex(
-      const char *beginx, const char *endx)
+      const char *begin, const char *end)
   {
     sort();
-    auto begin = reinterpret_cast<const unsigned char*>(beginx);
+    return static_cast<const Operator_Table*>(this)->lex(begin, end);
+  }
+  bool Operator_Table::sorted() const
+  {
+    return sorted_;
+  }
+  bool Operator_Table::joins(char a, char b) const
+  {
+    uint16_t x = uint16_t((unsigned char)a) << 8 | (unsigned char)b;
+    return binary_search(pairs_.begin(), pairs_.end(), x);
+  }
+  uint64_t Operator_Table::version() const
+  {
+    return version_;
+  }
+  static uint64_t mix(uint64_t h, uint64_t x)
+  {
+    h = (h ^ x) * UINT64_C(0x9e3779b97f4a7c15);
+    return h ^ (h >> 29);
+  }
+  static uint64_t mix(uint64_t h, const Operator &o)
+  {
+    return mix(h, uint64_t(o.id) | uint64_t(o.precedence) << 8
+        | uint64_t(o.left_associative) << 16 | uint64_t(o.function) << 17
+        | uint64_t(o.sign_overload) << 18 | uint64_t(o.min_arity) << 24
+        | uint64_t(o.max_arity) << 32);
+  }
+  uint64_t Operator_Table::fingerprint() const
+  {
+    // i.e. a sum of the entry hashes is independent of their order
+    uint64_t h = table_.size();
+    for (auto &x : table_) {
+      uint64_t k = 0;
+      for (size_t i = 0; i < x.first.size(); ++i)
+        k |= uint64_t(x.first[i]) << (8 * i);
+      h += mix(mix(1, k), x.second);
+    }
+    return h;
+  }
+  Operator_Table::Result Operator_Table::lex(
+      const char *begin, const char *end) const
+  {
+    auto r = try_lex(begin, end);
+    if (r.id == INVALID)
+      throw range_error("no operator/operand to lex");
+    return r;
+  }
+  Operator_Table::Result Operator_Table::try_lex(
+      const char *beginx, const char *endx, size_t *probes) const
+  {
+    (void)probes;
+    if (!sorted_)
+      throw logic_error("operator table isn't sorted");
     auto end   = reinterpret_cast<const unsigned char*>(endx);
-    auto p = begin;
-    p = find_if_not(p, end, [](unsigned char c) {
-        return c == ' ' || c == '\t' || c == '\n' || c == '\r'; });
+    auto p = reinterpret_cast<const unsigned char*>(
+        skip_space(beginx, endx));
     if (p == end)
       return Result(end, end, EPSILON, nullptr);
-    auto r = upper_bound(table_.begin(), table_.end(), make_pair(p, end),
-        Op_Compare());
-    if (r != table_.end()) {
-      for ( ; r != table_.end(); ++r) {
-        Operator *op = &(*r).second;
-        auto e = find((*r).first.begin(), (*r).first.end(), 0+0);
-        auto f = common_prefix((*r).first.begin(), e, p, end);
-        if (f == (*r).first.begin())
-          break;
-        if (e == f) {
-          auto n = e - (*r).first.begin();
-          return Result(p, p+n, op->id, op);
-        }
+    int op = -1;
+    auto op_end = p;
+    auto q = p;
+    for (uint16_t n = first_[*q]; n; ) {
+      SYARD_COUNT(probes && ++*probes);
+      ++q;
+      if (nodes_[n].op >= 0) {
+        op = nodes_[n].op;
+        op_end = q;
       }
+      if (q == end)
+        break;
+      for (n = nodes_[n].child; n && nodes_[n].byte != *q;
+          n = nodes_[n].sibling)
+        SYARD_COUNT(probes && ++*probes);
     }
-    auto b = p;
-    if ((*p >= '0' && *p <= '9') || *p == '.') {
-      p = find_if_not(p, end, [](char c) {
-          return (c >= '0' && c <= '9') || c == '.'; });
-      return Result(b, p, OPERAND, nullptr);
-    } else if ((*p >= 'a' && *p <= 'z') || *p == '_') {
-      p = find_if_not(p, end, [](char c) {
-          return (c >= 'a' && c <= 'z') || c == '_'; });
-      return Result(b, p, FUNCTION, nullptr);
+    if (op >= 0) {
+      const Operator *o = &table_[op].second;
+      return Result(p, op_end, o->id, o);
     }
-    throw range_error("no operator/operand to lex");
+    auto b = reinterpret_cast<const char*>(p);
+    if (is_number(*b))
+      return Result(b, scan_number(b, endx), OPERAND, nullptr);
+    else if (is_name(*b))
+      return Result(b, scan_name(b, endx), FUNCTION, nullptr);
+    return Result(b, b + 1, INVALID, nullptr);
   }
   void Operator_Table::insert_default_arithmetic()
   {
@@ -185,79 +302,344 @@ namespace syard {
     sort();
   }
 
-  bool Function_Compare::operator()(
-      const std::array<char, MAX_FUNCTION_SIZE>   &a,
-      const std::pair<const char *, const char *> &b) const
-  {
-    auto n = b.second - b.first;
-    return lexicographical_compare(a.begin(), min(a.begin() + n, a.end()),
-        b.first, b.second);
-  }
-  bool Function_Compare::operator()(
-      const std::pair<const char *, const char *> &a,
-      const std::array<char, MAX_FUNCTION_SIZE>   &b) const
+  Function_Table::Function_Table()
+    : version_(next_version())
   {
-    auto n = a.second - a.first;
-    return lexicographical_compare(a.first, a.second,
-        b.begin(), min(b.begin() + n, b.end()));
   }
-  bool Function_Compare::operator()(
-      const std::array<char, MAX_FUNCTION_SIZE> &a,
-      const std::array<char, MAX_FUNCTION_SIZE> &b) const
-  {
-    return a < b;
-  }
-
-  Function_Table::Function_Table() =default;
 
-  void Function_Table::insert(const char *begin, const char *end, uint8_t id)
+  void Function_Table::insert(const char *begin, const char *end, uint8_t id,
+      uint8_t min_arity, uint8_t max_arity)
   {
+    if (min_arity > max_arity)
+      throw invalid_argument("min arity exceeds max arity");
     if (end-begin >= MAX_FUNCTION_SIZE)
       throw length_error("only function names up to "
           + to_string(MAX_FUNCTION_SIZE) + " chars");
-    array<char, MAX_FUNCTION_SIZE> a;
-    copy(begin, end, a.begin());
-    fill(a.begin() + (end-begin), a.end(), 0);
-    table_.emplace(a, make_unique<Operator>(id));
+    if (table_.size() >= UINT16_MAX)
+      throw overflow_error("too many functions");
+    table_.emplace_back();
+    auto &t = table_.back();
+    copy(begin, end, t.first.begin());
+    fill(t.first.begin() + (end-begin), t.first.end(), 0);
+    t.second = Operator(id);
+    t.second.min_arity = min_arity;
+    t.second.max_arity = max_arity;
+    frozen_ = false;
+    version_ = next_version();
+  }
+  void Function_Table::insert(const char *s, uint8_t id,
+      uint8_t min_arity, uint8_t max_arity)
+  {
+    insert(s, s+strlen(s), id, min_arity, max_arity);
   }
-  void Function_Table::insert(const char *s, uint8_t id)
+  size_t Function_Table::slot(const Key &k) const
   {
-    insert(s, s+strlen(s), id);
+    uint64_t x;
+    static_assert(sizeof x == sizeof k, "key must fit into a word");
+    memcpy(&x, k.data(), sizeof x);
+    // Fibonacci hashing, i.e. the high bits are well mixed
+    return (x * UINT64_C(0x9e3779b97f4a7c15)) >> shift_;
+  }
+  void Function_Table::freeze()
+  {
+    if (frozen_)
+      return;
+    size_t n = 8;
+    shift_ = 61;
+    for ( ; n < 2 * table_.size(); n *= 2)
+      --shift_;
+    slots_.assign(n, 0);
+    vector<pair<Key, Operator> > t;
+    t.reserve(table_.size());
+    for (auto &x : table_) {
+      size_t i = slot(x.first);
+      for ( ; slots_[i]; i = (i + 1) & (n - 1))
+        if (t[slots_[i] - 1].first == x.first)
+          break;
+      // i.e. the first insert wins
+      if (slots_[i])
+        continue;
+      t.push_back(x);
+      slots_[i] = t.size();
+    }
+    table_ = std::move(t);
+    frozen_ = true;
+  }
+  bool Function_Table::frozen() const
+  {
+    return frozen_;
+  }
+  uint64_t Function_Table::version() const
+  {
+    return version_;
+  }
+  uint64_t Function_Table::fingerprint() const
+  {
+    uint64_t h = table_.size();
+    for (auto &x : table_) {
+      uint64_t k = 0;
+      for (size_t i = 0; i < x.first.size(); ++i)
+        k |= uint64_t(uint8_t(x.first[i])) << (8 * i);
+      h += mix(mix(2, k), x.second);
+    }
+    return h;
   }
   const Operator *Function_Table::at(
       const pair<const char*, const char*> &p) const
   {
-    auto i = table_.find(p);
-    if (i == table_.end())
+    auto r = find(p);
+    if (!r)
       throw range_error("unknown function: " + string(p.first, p.second));
-    return (*i).second.get();
+    return r;
+  }
+  const Operator *Function_Table::find(
+      const pair<const char*, const char*> &p) const
+  {
+    if (p.second - p.first < MAX_FUNCTION_SIZE) {
+      Key k;
+      copy(p.first, p.second, k.begin());
+      fill(k.begin() + (p.second - p.first), k.end(), 0);
+      if (frozen_) {
+        size_t n = slots_.size();
+        for (size_t i = slot(k); slots_[i]; i = (i + 1) & (n - 1))
+          if (table_[slots_[i] - 1].first == k)
+            return &table_[slots_[i] - 1].second;
+      } else {
+        for (auto &x : table_)
+          if (x.first == k)
+            return &x.second;
+      }
+    }
+    return nullptr;
   }
 
-  Parser::Parser()
+  Symbol_Table::Symbol_Table()
+    : version_(next_version())
   {
-    vector<const Operator*> v;
-    v.reserve(8);
-    op_stack_ = Stack<const Operator*>(std::move(v));
-    vector<string> w;
-    w.reserve(8);
-    a_stack_ = Stack<string>(std::move(w));
+    offsets_.push_back(0);
+  }
+  // FNV-1a
+  size_t Symbol_Table::hash(const char *begin, const char *end)
+  {
+    uint64_t h = UINT64_C(0xcbf29ce484222325);
+    for ( ; begin != end; ++begin)
+      h = (h ^ (unsigned char)*begin) * UINT64_C(0x100000001b3);
+    return h;
+  }
+  size_t Symbol_Table::probe(const char *begin, const char *end) const
+  {
+    size_t n = slots_.size();
+    size_t i = hash(begin, end) & (n - 1);
+    for ( ; slots_[i]; i = (i + 1) & (n - 1)) {
+      auto a = names_.data() + offsets_[slots_[i] - 1];
+      auto b = names_.data() + offsets_[slots_[i]];
+      if (b - a == end - begin && equal(a, b, begin))
+        break;
+    }
+    return i;
+  }
+  void Symbol_Table::rehash()
+  {
+    slots_.assign(max(size_t(8), slots_.size() * 2), 0);
+    for (size_t i = 0; i + 1 < offsets_.size(); ++i) {
+      auto b = names_.data() + offsets_[i];
+      slots_[probe(b, names_.data() + offsets_[i+1])] = i + 1;
+    }
+  }
+  uint16_t Symbol_Table::insert(const char *begin, const char *end)
+  {
+    int r = find(make_pair(begin, end));
+    if (r >= 0)
+      return r;
+    if (size() >= UINT16_MAX)
+      throw overflow_error("too many variables");
+    names_.append(begin, end);
+    offsets_.push_back(names_.size());
+    version_ = next_version();
+    if (2 * size() > slots_.size())
+      rehash();
+    else
+      slots_[probe(begin, end)] = size();
+    return size() - 1;
+  }
+  uint16_t Symbol_Table::insert(const char *s)
+  {
+    return insert(s, s+strlen(s));
+  }
+  int Symbol_Table::find(const pair<const char*, const char*> &p) const
+  {
+    if (slots_.empty())
+      return -1;
+    return int(slots_[probe(p.first, p.second)]) - 1;
+  }
+  size_t Symbol_Table::size() const
+  {
+    return offsets_.size() - 1;
+  }
+  string Symbol_Table::name(uint16_t slot) const
+  {
+    if (slot >= size())
+      throw range_error("unknown variable slot");
+    return names_.substr(offsets_[slot], offsets_[slot+1] - offsets_[slot]);
+  }
+  uint64_t Symbol_Table::version() const
+  {
+    return version_;
+  }
+
+  template <> string to_operand<string>(const Sign &sign,
+      const pair<const char*, const char*> &p)
+  {
+    if (sign.empty())
+      return string(p.first, p.second);
+    string r;
+    r.reserve((sign.end - sign.begin) + (p.second - p.first));
+    remove_copy_if(sign.begin, sign.end, back_inserter(r), is_space);
+    r.append(p.first, p.second);
+    return r;
+  }
+  template <> int64_t to_operand<int64_t>(const Sign &sign,
+      const pair<const char*, const char*> &p)
+  {
+    return parse_number<int64_t>(p.first, p.second, sign.negative);
+  }
+  template <> double to_operand<double>(const Sign &sign,
+      const pair<const char*, const char*> &p)
+  {
+    return parse_number<double>(p.first, p.second, sign.negative);
+  }
 
+  template <> Error_Code try_to_operand<string>(const Sign &sign,
+      const pair<const char*, const char*> &p, string &r)
+  {
+    r = to_operand<string>(sign, p);
+    return ERR_NONE;
+  }
+  template <> Error_Code try_to_operand<int64_t>(const Sign &sign,
+      const pair<const char*, const char*> &p, int64_t &r)
+  {
+    return try_parse_number(p.first, p.second, sign.negative, r);
+  }
+  template <> Error_Code try_to_operand<double>(const Sign &sign,
+      const pair<const char*, const char*> &p, double &r)
+  {
+    return try_parse_number(p.first, p.second, sign.negative, r);
+  }
+
+  Grammar::Grammar()
+  {
     op_table_.insert('(', LEFT_PAREN , 0, true);
     op_table_.insert(')', RIGHT_PAREN, 0, true);
     op_table_.insert(',', COMMA      , 0, true);
     op_table_.sort();
   }
-  Operator_Table &Parser::operator_table()
+  Operator_Table &Grammar::operator_table()
+  {
+    return op_table_;
+  }
+  Function_Table &Grammar::function_table()
+  {
+    return function_table_;
+  }
+  Symbol_Table &Grammar::symbol_table()
+  {
+    return symbol_table_;
+  }
+  const Operator_Table &Grammar::operator_table() const
   {
     return op_table_;
   }
+  const Function_Table &Grammar::function_table() const
+  {
+    return function_table_;
+  }
+  const Symbol_Table &Grammar::symbol_table() const
+  {
+    return symbol_table_;
+  }
+  void Grammar::freeze()
+  {
+    op_table_.sort();
+    function_table_.freeze();
+  }
+  bool Grammar::frozen() const
+  {
+    return op_table_.sorted() && function_table_.frozen();
+  }
+  uint64_t Grammar::version() const
+  {
+    // the table versions are unique, i.e. mixing them is sufficient
+    uint64_t h = op_table_.version();
+    h = (h ^ (h >> 29)) * UINT64_C(0x9e3779b97f4a7c15)
+      + function_table_.version();
+    h = (h ^ (h >> 29)) * UINT64_C(0x9e3779b97f4a7c15)
+      + symbol_table_.version();
+    return h;
+  }
+  uint64_t Grammar::fingerprint() const
+  {
+    return mix(mix(0, op_table_.fingerprint()),
+        function_table_.fingerprint());
+  }
+
+  impl::Shunt_State::Shunt_State()
+  {
+    vector<Pending> v;
+    v.reserve(8);
+    op_stack = Stack<Pending>(std::move(v));
+    vector<unsigned> u;
+    u.reserve(8);
+    argc_stack = Stack<unsigned>(std::move(u));
+  }
+
+  Parser::Parser()
+  {
+    vector<string> w;
+    w.reserve(8);
+    a_stack_ = Stack<string>(std::move(w));
+  }
+  Parser::Parser(std::shared_ptr<const Grammar> g)
+    : Parser()
+  {
+    if (!g || !g->frozen())
+      throw invalid_argument("shared grammar must be frozen");
+    shared_ = std::move(g);
+  }
+  static void check_mutable(const shared_ptr<const Grammar> &g)
+  {
+    if (g)
+      throw logic_error("the grammar is shared, i.e. immutable");
+  }
+  Operator_Table &Parser::operator_table()
+  {
+    check_mutable(shared_);
+    return grammar_.operator_table();
+  }
   Stack<std::string> &Parser::arg_stack()
   {
     return a_stack_;
   }
+  const Parse_Stats &Parser::stats() const
+  {
+    return state_.stats;
+  }
+  void Parser::reset_stats()
+  {
+    state_.stats = Parse_Stats();
+  }
   Function_Table &Parser::function_table()
   {
-    return function_table_;
+    check_mutable(shared_);
+    return grammar_.function_table();
+  }
+  Symbol_Table &Parser::symbol_table()
+  {
+    check_mutable(shared_);
+    return grammar_.symbol_table();
+  }
+  const Grammar &Parser::grammar() const
+  {
+    return shared_ ? *shared_ : grammar_;
   }
   void Parser::parse(const char *s, std::function<void(uint8_t id)> f)
   {
@@ -266,78 +648,7 @@ namespace syard {
   void Parser::parse(const char *begin, const char *end,
       std::function<void(uint8_t id)> f)
   {
-    auto b = begin;
-    uint8_t last_id = EPSILON;
-    string sign;
-    for (;;) {
-      auto r = op_table_.lex(b, end);
-      switch (r.id) {
-        case EPSILON:
-          while (!op_stack_.empty()) {
-            if (op_stack_.top()->id < FIRST_ID)
-              throw underflow_error("unmatched element");
-            f(op_stack_.top()->id);
-            op_stack_.pop();
-          }
-          return;
-        case FUNCTION:
-          op_stack_.push(function_table_.at(r.p));
-          break;
-        case OPERAND:
-          if (sign.empty())
-            a_stack_.push(string(r.p.first, r.p.second));
-          else {
-            a_stack_.push(sign + string(r.p.first, r.p.second));
-            sign.clear();
-          }
-          break;
-        case LEFT_PAREN:
-          op_stack_.push(r.op);
-          break;
-        case RIGHT_PAREN:
-          while (!op_stack_.empty() && op_stack_.top()->id != LEFT_PAREN) {
-            f(op_stack_.top()->id);
-            op_stack_.pop();
-          }
-          if (op_stack_.empty() || op_stack_.top()->id != LEFT_PAREN)
-            throw underflow_error("unmatched paren");
-          op_stack_.pop();
-          if (!op_stack_.empty() && op_stack_.top()->function) {
-            if (op_stack_.top()->id < FIRST_ID)
-              throw underflow_error("unexpected operator");
-            f(op_stack_.top()->id);
-            op_stack_.pop();
-          }
-          break;
-        case COMMA:
-          while (!op_stack_.empty() && op_stack_.top()->id != LEFT_PAREN) {
-            f(op_stack_.top()->id);
-            op_stack_.pop();
-          }
-          if (op_stack_.empty() || op_stack_.top()->id != LEFT_PAREN)
-            throw underflow_error("unmatched paren");
-          break;
-        default:
-          if ( (last_id == OPERATOR || last_id == LEFT_PAREN
-                || last_id == COMMA || last_id == EPSILON)
-              && r.op->sign_overload) {
-            sign.insert(sign.end(), r.p.first, r.p.second);
-          } else {
-            while (!op_stack_.empty()
-                && op_stack_.top()->id >= FIRST_ID
-                && (  (r.op->left_associative
-                    && r.op->precedence <= op_stack_.top()->precedence)
-                  || (!r.op->left_associative
-                    && r.op->precedence <  op_stack_.top()->precedence))) {
-              f(op_stack_.top()->id);
-              op_stack_.pop();
-            }
-            op_stack_.push(r.op);
-          }
-      }
-      b = r.p.second;
-      last_id = r.id < FIRST_ID ? r.id : OPERATOR;
-    }
+    parse(begin, end, a_stack_, f);
   }
 
 } // syard
@@ -22,11 +22,16 @@
 
 }}} */
 
-#include <map>
+#include <algorithm>
+#include <array>
+#include <functional>
 #include <memory>
 #include <stack>
 #include <stddef.h>
+#include <stdexcept>
 #include <stdint.h>
+#include <string.h>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -38,12 +43,27 @@ namespace syard {
     bool sign_overload;
     uint8_t precedence;
     uint8_t id;
+    // the argument counts a function accepts, cf. Function_Table
+    uint8_t min_arity {0};
+    uint8_t max_arity {255};
     Operator();
     Operator(uint8_t id);
+    // i.e. for the operators of a Static_Grammar
+    constexpr Operator(uint8_t id, uint8_t precedence, bool left_associative,
+        bool function, bool sign_overload, uint8_t min_arity = 0,
+        uint8_t max_arity = 255)
+      : left_associative(left_associative), function(function),
+        sign_overload(sign_overload), precedence(precedence), id(id),
+        min_arity(min_arity), max_arity(max_arity)
+    {
+    }
   };
 
   enum Token : uint8_t { 
     EPSILON, OPERAND, FUNCTION, LEFT_PAREN, RIGHT_PAREN, COMMA, OPERATOR,
+    VARIABLE,
+    NEGATE = 8,  // i.e. a sign before a variable, paren or function
+    INVALID = 9, // i.e. a lex error, cf. Operator_Table::try_lex()
     FIRST_ID = 10
   };
 
@@ -56,23 +76,110 @@ namespace syard {
     MINUS = 14
   };
 
+  // the errors Parser::try_parse() and Parser::try_compile() report
+  // instead of throwing
+  enum Error_Code : uint8_t {
+    ERR_NONE,
+    ERR_LEX,               // no operator/operand to lex
+    ERR_UNKNOWN_NAME,      // neither a function nor a variable
+    ERR_UNMATCHED_PAREN,
+    ERR_UNMATCHED_ELEMENT, // i.e. an unclosed paren at the end
+    ERR_UNEXPECTED_OPERATOR,
+    ERR_MALFORMED_NUMBER,
+    ERR_NUMBER_RANGE,
+    ERR_VARIABLE,          // i.e. a variable without value
+    ERR_MISSING_OPERAND,
+    ERR_LIMIT,             // too many constants/arguments
+    ERR_ARITY              // cf. Function_Table::insert()
+  };
+  // returns a static string, i.e. doesn't allocate
+  const char *error_string(Error_Code c);
+
+  struct Parse_Error {
+    Error_Code code {ERR_NONE};
+    // of the offending token, relative to the begin of the input
+    size_t offset {0};
+    // points into the input
+    std::pair<const char *, const char *> token {nullptr, nullptr};
+
+    // i.e. true on error
+    explicit operator bool() const { return code != ERR_NONE; }
+    // error_string() plus the offending name/number
+    std::string message() const;
+    // throws the exception the throwing API would have thrown, e.g.
+    // range_error for ERR_UNKNOWN_NAME
+    [[noreturn]] void raise() const;
+  };
+
+  // i.e. the hot path counters are compiled out unless SYARD_STATS is
+  // defined (cf. the SYARD_STATS cmake option)
+#ifdef SYARD_STATS
+  #define SYARD_COUNT(...) ((void)(__VA_ARGS__))
+#else
+  #define SYARD_COUNT(...) ((void)0)
+#endif
+
+  // Counters of Parser::parse() and friends, accumulated over all
+  // parses until Parser::reset_stats(). Without SYARD_STATS they stay
+  // zero.
+  struct Parse_Stats {
+    size_t parses {0};
+    // indexed by Token, i.e. operators are counted as OPERATOR and
+    // names that resolve to variables as VARIABLE
+    std::array<size_t, FIRST_ID> tokens {};
+    // trie nodes visited by Operator_Table::try_lex()
+    size_t lex_probes {0};
+    size_t max_op_stack {0};
+    // i.e. of the operand stack, as implied by the RPN
+    size_t max_arg_stack {0};
+    // capacity growths of the operator and argument count stacks
+    size_t reallocations {0};
+    size_t function_lookups {0};
+    // i.e. names that are variables or unknown
+    size_t function_misses {0};
+  };
+
   enum { MAX_OPERATOR_SIZE = 4 };
   class Operator_Table {
     private:
       std::vector<std::pair<std::array<unsigned char, MAX_OPERATOR_SIZE>,
                             Operator> > table_;
       bool sorted_ {false};
+
+      // longest-match trie over the operator bytes, built by sort(),
+      // index 0 is used as null link
+      struct Trie_Node {
+        uint16_t child   {0};
+        uint16_t sibling {0};
+        int16_t  op      {-1}; // index into table_
+        unsigned char byte {0};
+      };
+      std::array<uint16_t, 256> first_ {};
+      std::vector<Trie_Node> nodes_;
+      // the (sorted) byte pairs that occur within an operator
+      std::vector<uint16_t> pairs_;
+      uint64_t version_;
     public:
       struct Result {
         std::pair<const char *, const char *> p;
         uint8_t id;
         const Operator *op;
-        Result(const char *begin, const char *end, uint8_t id, Operator *op);
+        Result(const char *begin, const char *end, uint8_t id,
+            const Operator *op)
+          : p(begin, end), id(id), op(op)
+        {
+        }
         Result(const unsigned char *begin, const unsigned char *end,
-            uint8_t id, Operator *op);
+            uint8_t id, const Operator *op);
       };
       Operator_Table();
       Result lex(const char *begin, const char *end);
+      // requires a sorted table, i.e. safe to call concurrently
+      Result lex(const char *begin, const char *end) const;
+      // returns an INVALID token instead of throwing on unlexable input,
+      // adds the number of visited trie nodes to *probes (SYARD_STATS)
+      Result try_lex(const char *begin, const char *end,
+          size_t *probes = nullptr) const;
       void insert(const char *begin, const char *end, uint8_t id,
           uint8_t precedence, bool left_associative,
           bool sign_overload=false);
@@ -81,59 +188,640 @@ namespace syard {
       void insert(const char op, uint8_t id, uint8_t precedence,
           bool left_associative, bool sign_overload=false);
       void insert_default_arithmetic();
+      // (re-)builds the lookup structure, called lazily by lex()
       void sort();
+      bool sorted() const;
+      // i.e. some operator contains the bytes a, b in sequence, thus
+      // whitespace between them is significant
+      bool joins(char a, char b) const;
+      // changes with each insert, unique across all tables
+      uint64_t version() const;
+      // a hash of the operators, i.e. stable across processes and
+      // independent of the insert order
+      uint64_t fingerprint() const;
   };
 
   enum { MAX_FUNCTION_SIZE = 8 };
-  struct Function_Compare {
-    using is_transparent = std::true_type;
-    bool operator()(const std::array<char, MAX_FUNCTION_SIZE> &a,
-        const std::pair<const char *, const char *> &b) const;
-    bool operator()(const std::pair<const char *, const char *> &a,
-        const std::array<char, MAX_FUNCTION_SIZE> &b) const;
-    bool operator()(const std::array<char, MAX_FUNCTION_SIZE> &a,
-        const std::array<char, MAX_FUNCTION_SIZE> &b) const;
-  };
   class Function_Table {
     private:
-      // for unordered_map we need some generic hashing support,
-      // e.g. something like boost::hash_combine()
-      // using std::string() seems a bit wasteful, because it has 32 byte
-      // on 64 bit Linux for short strings up to 15 byte, over that
-      // 32 byte plus a heap allocation
-      // function names are expected to be relatively short
-      std::map<std::array<char, MAX_FUNCTION_SIZE>, std::unique_ptr<Operator>,
-        Function_Compare> table_;
+      // function names are expected to be relatively short, thus they
+      // are stored inline, zero padded, such that they can be hashed
+      // and compared as one 64 bit word
+      using Key = std::array<char, MAX_FUNCTION_SIZE>;
+      std::vector<std::pair<Key, Operator> > table_;
+      // open addressing with linear probing, i.e. index+1 into table_
+      // where 0 marks an empty slot, built by freeze()
+      std::vector<uint16_t> slots_;
+      unsigned shift_ {0};
+      bool frozen_ {false};
+      uint64_t version_;
+
+      size_t slot(const Key &k) const;
     public:
+      enum { VARIADIC = 255 };
+
       Function_Table();
-      void insert(const char *s, uint8_t id);
-      void insert(const char *begin, const char *end, uint8_t id);
+      // invalidates the pointers returned by at() (a parse in progress
+      // copies its pending operators, i.e. a callback may insert), an
+      // already inserted name isn't overwritten, calls with less than
+      // min_arity or more than max_arity arguments are rejected while
+      // parsing (ERR_ARITY)
+      void insert(const char *s, uint8_t id, uint8_t min_arity = 0,
+          uint8_t max_arity = VARIADIC);
+      void insert(const char *begin, const char *end, uint8_t id,
+          uint8_t min_arity = 0, uint8_t max_arity = VARIADIC);
+      // builds the hash index, called lazily by the Parser, lookups in an
+      // unfrozen table fall back to a linear search
+      void freeze();
+      bool frozen() const;
       const Operator *at(const std::pair<const char *, const char *> &s) const;
+      // returns nullptr for unknown names
+      const Operator *find(const std::pair<const char *, const char *> &s)
+        const;
+      // changes with each insert, unique across all tables
+      uint64_t version() const;
+      // cf. Operator_Table::fingerprint()
+      uint64_t fingerprint() const;
   };
 
-  template <typename T> using Stack = std::stack<T, std::vector<T> >;
+  // Maps variable names to slots, i.e. consecutive indices into the
+  // array of variable values a compiled program is evaluated with.
+  class Symbol_Table {
+    private:
+      // the names are concatenated, i.e. name i is
+      // [offsets_[i], offsets_[i+1])
+      std::string names_;
+      std::vector<uint32_t> offsets_;
+      // open addressing with linear probing, i.e. slot+1, 0 is empty
+      std::vector<uint16_t> slots_;
+      uint64_t version_;
 
-  class Parser {
+      static size_t hash(const char *begin, const char *end);
+      size_t probe(const char *begin, const char *end) const;
+      void rehash();
+    public:
+      Symbol_Table();
+      // returns the slot, i.e. the existing one for known names
+      uint16_t insert(const char *s);
+      uint16_t insert(const char *begin, const char *end);
+      // returns -1 for unknown names
+      int find(const std::pair<const char *, const char *> &s) const;
+      size_t size() const;
+      std::string name(uint16_t slot) const;
+      // changes with each new name, unique across all tables
+      uint64_t version() const;
+  };
+
+  // The operator, function and variable definitions a Parser works
+  // with. A frozen Grammar is immutable and thus can be shared between
+  // many parsers, i.e. also between threads, without copying or locking,
+  // e.g.:
+  //
+  //     auto g = std::make_shared<Grammar>();
+  //     g->operator_table().insert_default_arithmetic();
+  //     g->freeze();
+  //     Parser p(g);
+  class Grammar {
     private:
       Operator_Table op_table_;
       Function_Table function_table_;
+      Symbol_Table symbol_table_;
+    public:
+      // i.e. with parentheses and comma
+      Grammar();
+      // inserts unfreeze the grammar
+      Operator_Table &operator_table();
+      Function_Table &function_table();
+      Symbol_Table &symbol_table();
+      const Operator_Table &operator_table() const;
+      const Function_Table &function_table() const;
+      const Symbol_Table &symbol_table() const;
+      // builds the lookup structures
+      void freeze();
+      bool frozen() const;
+      // changes whenever one of the tables changes, i.e. copies of a
+      // grammar share the version until they are modified
+      uint64_t version() const;
+      // of the operators and functions, i.e. in contrast to version() it
+      // identifies equal grammars across processes, cf. save()
+      uint64_t fingerprint() const;
+  };
+
+  template <typename T> using Stack = std::stack<T, std::vector<T> >;
+
+  template <typename T> class Program; // see program.hh
+  class Ast; // see ast.hh
+
+  // the sign overloaded operators (e.g. '-' in `-2`) that directly
+  // precede a number, i.e. they are folded into the operand (cf. NEGATE)
+  struct Sign {
+    const char *begin {nullptr};
+    const char *end {nullptr};
+    bool negative {false}; // i.e. an odd number of MINUS signs
+    bool empty() const { return begin == end; }
+  };
+
+  // converts an OPERAND token into an operand of type T, i.e. the
+  // operand type of Parser::parse() and Parser::compile()
+  template <typename T>
+    T to_operand(const Sign &sign,
+        const std::pair<const char*, const char*> &p);
+  // concatenates sign and operand, i.e. "-" "2" -> "-2"
+  template <> std::string to_operand<std::string>(const Sign &sign,
+      const std::pair<const char*, const char*> &p);
+  template <> int64_t to_operand<int64_t>(const Sign &sign,
+      const std::pair<const char*, const char*> &p);
+  template <> double to_operand<double>(const Sign &sign,
+      const std::pair<const char*, const char*> &p);
+  // i.e. without throwing, cf. Parser::try_parse()
+  template <typename T>
+    Error_Code try_to_operand(const Sign &sign,
+        const std::pair<const char*, const char*> &p, T &r);
+  template <> Error_Code try_to_operand<std::string>(const Sign &sign,
+      const std::pair<const char*, const char*> &p, std::string &r);
+  template <> Error_Code try_to_operand<int64_t>(const Sign &sign,
+      const std::pair<const char*, const char*> &p, int64_t &r);
+  template <> Error_Code try_to_operand<double>(const Sign &sign,
+      const std::pair<const char*, const char*> &p, double &r);
+
+  namespace impl {
+
+    // an operator/function on the operator stack, i.e. with its token -
+    // a copy, as a callback may insert into the tables, which moves
+    // their operators
+    struct Pending {
+      Operator op;
+      std::pair<const char *, const char *> p;
+    };
+    // the stacks of the shunting-yard loop, i.e. they are reused by the
+    // next parse
+    struct Shunt_State {
+      Stack<Pending> op_stack;
+      Stack<unsigned> argc_stack;
+      Parse_Stats stats;
+      Shunt_State();
+    };
+
+    template <typename T> size_t capacity(const Stack<T> &s)
+    {
+      // i.e. the underlying container is a protected member
+      struct Access : Stack<T> {
+        static size_t get(const Stack<T> &s)
+        {
+          return (s.*&Access::c).capacity();
+        }
+      };
+      return Access::get(s);
+    }
+
+    // calls f(id, argc) if f takes the argument count, f(id) otherwise
+    template <typename F>
+      auto emit(F &f, uint8_t id, unsigned argc, int)
+      -> decltype(f(id, argc), void())
+      {
+        f(id, argc);
+      }
+    template <typename F>
+      void emit(F &f, uint8_t id, unsigned, long)
+      {
+        f(id);
+      }
+    template <typename F> void emit(F &f, uint8_t id, unsigned argc)
+    {
+      emit(f, id, argc, 0);
+    }
 
-      Stack<const Operator*> op_stack_;
+    // operators are binary, the argument count of functions is only
+    // known when they are followed by a parenthesized argument list
+    inline unsigned default_argc(const Operator *op)
+    {
+      return op->function ? 0 : 2;
+    }
+
+    // the shunting-yard loop, lexes with l.lex(begin, end, probes),
+    // resolves names with l.function(p) and l.variable(p), calls
+    // o(sign, p) for each operand, v(p, slot) for each variable and
+    // f(op, argc, p) for each operator/function in RPN order, the
+    // callbacks return an Error_Code that aborts the loop, i.e. it
+    // doesn't throw by itself - a sign run is folded into the number it
+    // precedes, before a variable, paren or function f is called with
+    // the NEGATE operator (once, if the run negates) - f is only called
+    // if argc operands are available and the input has to yield exactly
+    // one value (unless it's empty), i.e. ERR_MISSING_OPERAND otherwise
+    template <typename L, typename O, typename V, typename F>
+      Parse_Error shunt(Shunt_State &s, L &l,
+          const char *begin, const char *end, O o, V v, F f);
+
+  } // impl
+
+  class Parser {
+    private:
+      Grammar grammar_;
+      std::shared_ptr<const Grammar> shared_;
+
+      impl::Shunt_State state_;
       Stack<std::string> a_stack_;
 
       const char *begin_;
       const char *end_;
+
+      // lexes with the (runtime) tables of the grammar, an own grammar
+      // might be extended during parsing, i.e. it's (lazily) sorted
+      // again before each token
+      struct Table_Lexer {
+        Operator_Table *own;
+        const Operator_Table &ops;
+        const Function_Table &functions;
+        const Symbol_Table &symbols;
+
+        Operator_Table::Result lex(const char *begin, const char *end,
+            size_t *probes)
+        {
+          if (own)
+            own->sort();
+          return ops.try_lex(begin, end, probes);
+        }
+        const Operator *function(
+            const std::pair<const char*, const char*> &p) const
+        {
+          return functions.find(p);
+        }
+        int variable(const std::pair<const char*, const char*> &p) const
+        {
+          return symbols.find(p);
+        }
+      };
+      // cf. impl::shunt()
+      template <typename O, typename V, typename F>
+        Parse_Error shunt(const char *begin, const char *end,
+            O o, V v, F f);
     public:
       Parser();
+      // lexes against a shared, frozen grammar
+      explicit Parser(std::shared_ptr<const Grammar> g);
       void parse(const char *begin, const char *end,
           std::function<void(uint8_t id)> f);
       void parse(const char *s, std::function<void(uint8_t id)> f);
+      // in contrast to the std::function overloads, f can be inlined
+      // into the shunting-yard loop - and it may take the argument count
+      // as well, i.e. f(id, argc), which is validated against the arity
+      // of functions (cf. Function_Table::insert()) - negated variables,
+      // parens and functions (e.g. `-(1+2)`) yield f(NEGATE) after their
+      // operands
+      template <typename F>
+        void parse(const char *begin, const char *end, F f);
+      template <typename F>
+        void parse(const char *s, F f);
+      // pushes the operands as native values (e.g. int64_t or double)
+      // instead of strings on the arg_stack(), throws for variables,
+      // i.e. use compile() and an Evaluator for those
+      template <typename T, typename F>
+        void parse(const char *begin, const char *end, Stack<T> &stack,
+            F f);
+      template <typename T, typename F>
+        void parse(const char *s, Stack<T> &stack, F f);
+      template <typename F>
+        void parse(const char *begin, const char *end,
+            Stack<std::string> &stack, F f);
+
+      // like parse(), but malformed input is reported via the result
+      // instead of an exception, i.e. without unwinding and without
+      // allocating
+      template <typename T, typename F>
+        Parse_Error try_parse(const char *begin, const char *end,
+            Stack<T> &stack, F f);
+      template <typename T, typename F>
+        Parse_Error try_parse(const char *s, Stack<T> &stack, F f);
+      template <typename F>
+        Parse_Error try_parse(const char *begin, const char *end,
+            Stack<std::string> &stack, F f);
+
+      // parse once, run many times - cf. Program::run()
+      // (defined in program.hh)
+      template <typename T = std::string>
+        Program<T> compile(const char *begin, const char *end);
+      template <typename T = std::string>
+        Program<T> compile(const char *s);
+      // clears p, which thus can be reused
+      template <typename T>
+        Parse_Error try_compile(const char *begin, const char *end,
+            Program<T> &p);
+      // builds a tree instead, reuses (i.e. invalidates) the nodes of a
+      // previous parse into ast (defined in ast.cc)
+      void parse_ast(const char *begin, const char *end, Ast &ast);
+      void parse_ast(const char *s, Ast &ast);
+      Parse_Error try_parse_ast(const char *begin, const char *end, Ast &ast);
 
+      // the table accessors throw logic_error when the grammar is shared
       Operator_Table &operator_table();
       Stack<std::string> &arg_stack();
       Function_Table &function_table();
+      // names that aren't functions are looked up as variables
+      Symbol_Table &symbol_table();
+      const Grammar &grammar() const;
+
+      // only maintained when compiled with SYARD_STATS
+      const Parse_Stats &stats() const;
+      void reset_stats();
   };
 
+  template <typename F>
+    void Parser::parse(const char *s, F f)
+    {
+      parse(s, s+strlen(s), a_stack_, f);
+    }
+  template <typename F>
+    void Parser::parse(const char *begin, const char *end, F f)
+    {
+      parse(begin, end, a_stack_, f);
+    }
+  template <typename T, typename F>
+    void Parser::parse(const char *s, Stack<T> &stack, F f)
+    {
+      parse(s, s+strlen(s), stack, f);
+    }
+  template <typename T, typename F>
+    void Parser::parse(const char *begin, const char *end, Stack<T> &stack,
+        F f)
+    {
+      auto e = shunt(begin, end,
+          [&stack](const Sign &sign,
+            const std::pair<const char*, const char*> &p) {
+            stack.push(to_operand<T>(sign, p));
+            return ERR_NONE;
+          },
+          [](const std::pair<const char*, const char*> &, uint16_t) {
+            return ERR_VARIABLE; },
+          [&f](const Operator *op, unsigned argc,
+            const std::pair<const char*, const char*> &) {
+            impl::emit(f, op->id, argc);
+            return ERR_NONE;
+          });
+      if (e)
+        e.raise();
+    }
+  // i.e. variable names are pushed as is, like the other operands
+  template <typename F>
+    void Parser::parse(const char *begin, const char *end,
+        Stack<std::string> &stack, F f)
+    {
+      auto o = [&stack](const Sign &sign,
+          const std::pair<const char*, const char*> &p) {
+        stack.push(to_operand<std::string>(sign, p));
+        return ERR_NONE;
+      };
+      auto e = shunt(begin, end, o,
+          [&o](const std::pair<const char*, const char*> &p, uint16_t) {
+            return o(Sign(), p); },
+          [&f](const Operator *op, unsigned argc,
+            const std::pair<const char*, const char*> &) {
+            impl::emit(f, op->id, argc);
+            return ERR_NONE;
+          });
+      if (e)
+        e.raise();
+    }
+
+  template <typename T, typename F>
+    Parse_Error Parser::try_parse(const char *s, Stack<T> &stack, F f)
+    {
+      return try_parse(s, s+strlen(s), stack, f);
+    }
+  template <typename T, typename F>
+    Parse_Error Parser::try_parse(const char *begin, const char *end,
+        Stack<T> &stack, F f)
+    {
+      return shunt(begin, end,
+          [&stack](const Sign &sign,
+            const std::pair<const char*, const char*> &p) {
+            T v;
+            auto e = try_to_operand<T>(sign, p, v);
+            if (!e)
+              stack.push(std::move(v));
+            return e;
+          },
+          [](const std::pair<const char*, const char*> &, uint16_t) {
+            return ERR_VARIABLE; },
+          [&f](const Operator *op, unsigned argc,
+            const std::pair<const char*, const char*> &) {
+            impl::emit(f, op->id, argc);
+            return ERR_NONE;
+          });
+    }
+  template <typename F>
+    Parse_Error Parser::try_parse(const char *begin, const char *end,
+        Stack<std::string> &stack, F f)
+    {
+      auto o = [&stack](const Sign &sign,
+          const std::pair<const char*, const char*> &p) {
+        stack.push(to_operand<std::string>(sign, p));
+        return ERR_NONE;
+      };
+      return shunt(begin, end, o,
+          [&o](const std::pair<const char*, const char*> &p, uint16_t) {
+            return o(Sign(), p); },
+          [&f](const Operator *op, unsigned argc,
+            const std::pair<const char*, const char*> &) {
+            impl::emit(f, op->id, argc);
+            return ERR_NONE;
+          });
+    }
+
+  template <typename O, typename V, typename F>
+    Parse_Error Parser::shunt(const char *begin, const char *end,
+        O o, V v, F f)
+    {
+      if (!shared_)
+        grammar_.freeze();
+      const Grammar &g = grammar();
+      Table_Lexer l{shared_ ? nullptr : &grammar_.operator_table(),
+        g.operator_table(), g.function_table(), g.symbol_table()};
+      return impl::shunt(state_, l, begin, end, o, v, f);
+    }
+
+  template <typename L, typename O, typename V, typename F>
+    Parse_Error impl::shunt(Shunt_State &s, L &l,
+        const char *begin, const char *end, O o, V v, F f)
+    {
+      while (!s.op_stack.empty())
+        s.op_stack.pop();
+      while (!s.argc_stack.empty())
+        s.argc_stack.pop();
+      // i.e. the function with the wrong number of arguments
+      std::pair<const char*, const char*> call;
+      auto fail = [begin, &call](Error_Code c,
+          std::pair<const char*, const char*> p) {
+        if (c == ERR_ARITY)
+          p = call;
+        return Parse_Error{c, size_t(p.first - begin), p};
+      };
+      // i.e. of the operand stack, such that an operator without enough
+      // operands (e.g. `1 + * 2`) is rejected before f is called
+      size_t depth = 0;
+      SYARD_COUNT(++s.stats.parses);
+      auto push = [&](const Pending &x) {
+        SYARD_COUNT(s.stats.reallocations +=
+            s.op_stack.size() == capacity(s.op_stack));
+        s.op_stack.push(x);
+        SYARD_COUNT(s.stats.max_op_stack =
+            std::max(s.stats.max_op_stack, s.op_stack.size()));
+      };
+      // i.e. emits the top of the operator stack
+      auto pop = [&](unsigned argc) {
+        auto &t = s.op_stack.top();
+        if (t.op.function
+            && (argc < t.op.min_arity || argc > t.op.max_arity)) {
+          call = t.p;
+          return ERR_ARITY;
+        }
+        if (argc > depth)
+          return ERR_MISSING_OPERAND;
+        auto e = f(&t.op, argc, t.p);
+        s.op_stack.pop();
+        depth = depth - argc + 1;
+        SYARD_COUNT(s.stats.max_arg_stack =
+            std::max(s.stats.max_arg_stack, depth));
+        return e;
+      };
+      static constexpr Operator negate {NEGATE, 0, true, false, false};
+      auto b = begin;
+      uint8_t last_id = EPSILON;
+      Sign sign;
+      Error_Code e;
+      for (;;) {
+#ifdef SYARD_STATS
+        auto r = l.lex(b, end, &s.stats.lex_probes);
+        ++s.stats.tokens[r.id < FIRST_ID ? r.id : uint8_t(OPERATOR)];
+#else
+        auto r = l.lex(b, end, nullptr);
+#endif
+        switch (r.id) {
+          case INVALID:
+            return fail(ERR_LEX, r.p);
+          case EPSILON:
+            while (!s.op_stack.empty()) {
+              if (s.op_stack.top().op.id < FIRST_ID)
+                return fail(ERR_UNMATCHED_ELEMENT, r.p);
+              if ((e = pop(default_argc(&s.op_stack.top().op))))
+                return fail(e, r.p);
+            }
+            // i.e. exactly one value, unless the input is empty - e.g.
+            // `1 2`, `(1,2)`, `()` or a dangling sign are rejected
+            if (!sign.empty() || (depth != 1 && last_id != EPSILON))
+              return fail(ERR_MISSING_OPERAND, r.p);
+            return Parse_Error();
+          case FUNCTION:
+            SYARD_COUNT(++s.stats.function_lookups);
+            if (auto op = l.function(r.p)) {
+              // i.e. applied after the call, cf. RIGHT_PAREN
+              if (sign.negative)
+                push(Pending{negate, {sign.begin, sign.end}});
+              sign = Sign();
+              push(Pending{*op, r.p});
+            } else {
+              SYARD_COUNT(++s.stats.function_misses);
+              int slot = l.variable(r.p);
+              if (slot < 0)
+                return fail(ERR_UNKNOWN_NAME, r.p);
+              if ((e = v(r.p, slot)))
+                return fail(e, r.p);
+              if (sign.negative
+                  && (e = f(&negate, 1, {sign.begin, sign.end})))
+                return fail(e, r.p);
+              sign = Sign();
+              r.id = VARIABLE;
+              ++depth;
+              SYARD_COUNT(--s.stats.tokens[FUNCTION],
+                  ++s.stats.tokens[VARIABLE],
+                  s.stats.max_arg_stack = std::max(s.stats.max_arg_stack,
+                    depth));
+            }
+            break;
+          case OPERAND:
+            if ((e = o(sign, r.p)))
+              return fail(e, r.p);
+            sign = Sign();
+            ++depth;
+            SYARD_COUNT(s.stats.max_arg_stack =
+                std::max(s.stats.max_arg_stack, depth));
+            break;
+          case LEFT_PAREN:
+            if (sign.negative)
+              push(Pending{negate, {sign.begin, sign.end}});
+            sign = Sign();
+            push(Pending{*r.op, r.p});
+            SYARD_COUNT(s.stats.reallocations +=
+                s.argc_stack.size() == capacity(s.argc_stack));
+            s.argc_stack.push(0);
+            break;
+          case RIGHT_PAREN:
+            // i.e. a sign without operand, e.g. `(1, -)`
+            if (!sign.empty())
+              return fail(ERR_MISSING_OPERAND, r.p);
+            while (!s.op_stack.empty()
+                && s.op_stack.top().op.id != LEFT_PAREN) {
+              if ((e = pop(default_argc(&s.op_stack.top().op))))
+                return fail(e, r.p);
+            }
+            if (s.op_stack.empty() || s.op_stack.top().op.id != LEFT_PAREN)
+              return fail(ERR_UNMATCHED_PAREN, r.p);
+            s.op_stack.pop();
+            {
+              // i.e. number of commas plus one, unless it's an empty list
+              unsigned argc = s.argc_stack.top() + (last_id != LEFT_PAREN);
+              s.argc_stack.pop();
+              if (!s.op_stack.empty() && s.op_stack.top().op.function) {
+                if (s.op_stack.top().op.id < FIRST_ID)
+                  return fail(ERR_UNEXPECTED_OPERATOR, r.p);
+                if ((e = pop(argc)))
+                  return fail(e, r.p);
+              }
+            }
+            if (!s.op_stack.empty() && s.op_stack.top().op.id == NEGATE
+                && (e = pop(1)))
+              return fail(e, r.p);
+            break;
+          case COMMA:
+            if (!sign.empty())
+              return fail(ERR_MISSING_OPERAND, r.p);
+            while (!s.op_stack.empty()
+                && s.op_stack.top().op.id != LEFT_PAREN) {
+              if ((e = pop(default_argc(&s.op_stack.top().op))))
+                return fail(e, r.p);
+            }
+            if (s.op_stack.empty() || s.op_stack.top().op.id != LEFT_PAREN)
+              return fail(ERR_UNMATCHED_PAREN, r.p);
+            ++s.argc_stack.top();
+            break;
+          default:
+            if ( (last_id == OPERATOR || last_id == LEFT_PAREN
+                  || last_id == COMMA || last_id == EPSILON)
+                && r.op->sign_overload) {
+              if (sign.empty())
+                sign.begin = r.p.first;
+              sign.end = r.p.second;
+              sign.negative ^= r.op->id == MINUS;
+            } else {
+              // i.e. before a callback inserts into the table
+              Operator op = *r.op;
+              while (!s.op_stack.empty()
+                  && s.op_stack.top().op.id >= FIRST_ID
+                  && (  (op.left_associative
+                      && op.precedence <= s.op_stack.top().op.precedence)
+                    || (!op.left_associative
+                      && op.precedence <  s.op_stack.top().op.precedence)
+                    )) {
+                if ((e = pop(default_argc(&s.op_stack.top().op))))
+                  return fail(e, r.p);
+              }
+              push(Pending{op, r.p});
+            }
+        }
+        b = r.p.second;
+        last_id = r.id < FIRST_ID ? r.id : uint8_t(OPERATOR);
+      }
+    }
+
 } //syard
 
 #endif // SYARD_SYARD_HH
@@ -0,0 +1,91 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include <catch/catch.hpp>
+
+#include <syard/ast.hh>
+#include <string>
+
+using namespace std;
+using namespace syard;
+
+// i.e. as s-expression
+static string str(const Node *n)
+{
+  string r;
+  if (n->negative)
+    r += '-';
+  r.append(n->p.first, n->p.second);
+  if (n->code == OPERAND || n->code == VARIABLE)
+    return r;
+  r = "(" + r;
+  for (unsigned i = 0; i < n->argc; ++i)
+    r += " " + str(n->arg(i));
+  return r + ")";
+}
+
+TEST_CASE("ast_" "tree", "[ast]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.function_table().insert("max", 20);
+  p.symbol_table().insert("x");
+  p.symbol_table().insert("y");
+  Ast a;
+  p.parse_ast("1 + 2 * max(x, -y, 3) ^ 2", a);
+  REQUIRE(a.root());
+  CHECK(str(a.root()) == "(+ 1 (* 2 (^ (max x (- y) 3) 2)))");
+  CHECK(a.size() == 11);
+  CHECK(a.root()->code == PLUS);
+  auto m = a.root()->arg(1)->arg(1)->arg(0);
+  CHECK(m->code == 20);
+  CHECK(m->argc == 3);
+  CHECK(m->arg(1)->code == NEGATE);
+  CHECK(m->arg(1)->arg(0)->code == VARIABLE);
+  CHECK(m->arg(1)->arg(0)->slot == 1);
+
+  // i.e. the nodes reference the source
+  const char s[] = "(12.5 - x)";
+  p.parse_ast(s, a);
+  CHECK(a.root()->arg(0)->p.first == s + 1);
+  CHECK(a.root()->arg(0)->code == OPERAND);
+  CHECK(a.root()->p.first == s + 6);
+  CHECK(a.size() == 3);
+
+  p.parse_ast("", a);
+  CHECK(a.root() == nullptr);
+}
+
+TEST_CASE("ast_" "errors", "[ast]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  Ast a;
+  auto e = p.try_parse_ast("1 + * 2", "1 + * 2" + 7, a);
+  CHECK(e.code == ERR_MISSING_OPERAND);
+  const char s[] = "1 2";
+  e = p.try_parse_ast(s, s + 3, a);
+  CHECK(e.code == ERR_MISSING_OPERAND);
+  CHECK(e.offset == 3);
+  CHECK_THROWS_AS(p.parse_ast("(1 + 2", a), std::underflow_error);
+  CHECK_THROWS_AS(p.parse_ast("1 + foo", a), std::range_error);
+  p.parse_ast("2*3", a);
+  CHECK(str(a.root()) == "(* 2 3)");
+}
+
+TEST_CASE("ast_" "arena", "[ast]" )
+{
+  Arena a;
+  auto x = a.allocate(10, 1);
+  auto y = a.allocate(8, 8);
+  CHECK(reinterpret_cast<uintptr_t>(y) % 8 == 0);
+  CHECK(static_cast<char*>(y) >= static_cast<char*>(x) + 10);
+  auto z = a.allocate(3 * Arena::BLOCK_SIZE, 64);
+  CHECK(reinterpret_cast<uintptr_t>(z) % 64 == 0);
+  CHECK(a.used() == 18 + 3 * Arena::BLOCK_SIZE);
+  a.clear();
+  CHECK(a.used() == 0);
+  // i.e. the largest block is reused
+  auto w = a.allocate(2 * Arena::BLOCK_SIZE, 8);
+  CHECK(static_cast<char*>(w) <= static_cast<char*>(z));
+  CHECK(static_cast<char*>(z) - static_cast<char*>(w) < 64);
+}
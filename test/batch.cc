@@ -0,0 +1,102 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include <catch/catch.hpp>
+
+#include <syard/batch.hh>
+#include <math.h>
+#include <vector>
+
+using namespace std;
+using namespace syard;
+
+// price * qty - fee
+static Program<double> price_qty_fee()
+{
+  Program<double> p;
+  p.push_variable(0);
+  p.push_variable(1);
+  p.push_operator(MULT, 2);
+  p.push_variable(2);
+  p.push_operator(MINUS, 2);
+  return p;
+}
+
+TEST_CASE("batch_" "columns", "[batch]" )
+{
+  size_t n = 3 * Batch_Evaluator<double>::BLOCK + 7;
+  vector<double> price(n), qty(n), fee(n), out(n);
+  for (size_t i = 0; i < n; ++i) {
+    price[i] = i * 0.5;
+    qty[i] = i % 10;
+    fee[i] = 1.25;
+  }
+  const double *columns[] = { price.data(), qty.data(), fee.data() };
+  auto prog = price_qty_fee();
+  CHECK(prog.variables() == 3);
+  Batch_Evaluator<double> b;
+  b.run(prog, columns, out.data(), n);
+  Evaluator<double> e;
+  for (size_t i = 0; i < n; ++i) {
+    double vars[] = { price[i], qty[i], fee[i] };
+    CHECK(out[i] == price[i] * qty[i] - fee[i]);
+    CHECK(out[i] == e.run(prog, vars));
+  }
+
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  for (auto s : { "price", "qty", "fee" })
+    p.symbol_table().insert(s);
+  prog = p.compile<double>("-price * -(qty - fee)");
+  b.run(prog, columns, out.data(), n);
+  for (size_t i = 0; i < n; ++i)
+    CHECK(out[i] == price[i] * (qty[i] - fee[i]));
+}
+
+TEST_CASE("batch_" "constants and functions", "[batch]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.function_table().insert("sqrt", 20);
+  Batch_Evaluator<double> b;
+  b.insert(20, 1, [](double *out, const double * const *args, unsigned,
+        size_t n) {
+      for (size_t i = 0; i < n; ++i)
+        out[i] = sqrt(args[0][i]);
+      });
+  vector<double> out(1000);
+  b.run(p.compile<double>("sqrt(16)*2^3-1"), nullptr, out.data(), out.size());
+  for (auto x : out)
+    CHECK(x == 31.0);
+  b.run(p.compile<double>("42"), nullptr, out.data(), out.size());
+  for (auto x : out)
+    CHECK(x == 42.0);
+
+  Program<double> q;
+  q.push_constant(2);
+  q.push_variable(0);
+  q.push_operator(POWER, 2);
+  vector<double> in(1000);
+  for (size_t i = 0; i < in.size(); ++i)
+    in[i] = i % 20;
+  const double *columns[] = { in.data() };
+  b.run(q, columns, out.data(), out.size());
+  for (size_t i = 0; i < in.size(); ++i)
+    CHECK(out[i] == pow(2.0, in[i]));
+  CHECK_THROWS_AS(b.run(q, nullptr, out.data(), out.size()),
+      std::invalid_argument);
+  CHECK_THROWS_AS(b.run(p.compile<double>("sqrt(1, 2)"), nullptr,
+        out.data(), out.size()), std::invalid_argument);
+}
+
+TEST_CASE("batch_" "int", "[batch]" )
+{
+  Program<int64_t> p;
+  p.push_variable(0);
+  p.push_constant(3);
+  p.push_operator(DIV, 2);
+  vector<int64_t> in = { 3, 6, 10, -9 }, out(4);
+  const int64_t *columns[] = { in.data() };
+  Batch_Evaluator<int64_t> b;
+  b.run(p, columns, out.data(), out.size());
+  CHECK(out == vector<int64_t>({ 1, 2, 3, -3 }));
+}
@@ -0,0 +1,112 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include <catch/catch.hpp>
+
+#include <syard/cache.hh>
+#include <syard/eval.hh>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace syard;
+
+TEST_CASE("cache_" "normalize", "[cache]" )
+{
+  Operator_Table t;
+  t.insert_default_arithmetic();
+  string s;
+  auto n = [&t, &s](const char *x) {
+    normalize(t, x, x + strlen(x), s);
+    return s;
+  };
+  CHECK(n("  1 +\t2 * ( x )  ") == "1+2*(x)");
+  CHECK(n("1 2") == "1 2");
+  CHECK(n("ab cd") == "ab cd");
+  CHECK(n("ab 12") == "ab12");
+  CHECK(n("2 * * 3") == "2* *3");
+  CHECK(n("2 - - 3") == "2--3");
+  t.insert("--", 20, 9, true);
+  CHECK(n("2 - - 3") == "2- -3");
+  CHECK(n("") == "");
+  CHECK(n("  ") == "");
+}
+
+TEST_CASE("cache_" "hits", "[cache]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.symbol_table().insert("x");
+  Program_Cache<double> c(1 << 20);
+  auto a = c.get(p, "1 + 2 * x");
+  auto b = c.get(p, "1+2*x");
+  auto d = c.get(p, " 1 + 2*x ");
+  CHECK(a == b);
+  CHECK(a == d);
+  auto st = c.stats();
+  CHECK(st.hits == 2);
+  CHECK(st.misses == 1);
+  CHECK(st.entries == 1);
+  CHECK(st.bytes > 0);
+
+  // i.e. the grammar version is part of the key
+  p.symbol_table().insert("y");
+  auto e = c.get(p, "1+2*x");
+  CHECK(e != a);
+  CHECK(c.stats().misses == 2);
+  double x = 3;
+  CHECK(Evaluator<double>().run(*e, &x) == 7);
+
+  CHECK_THROWS_AS(c.get(p, "1 + z"), std::range_error);
+  CHECK(c.stats().entries == 2);
+  c.clear();
+  CHECK(c.stats().entries == 0);
+  CHECK(c.stats().bytes == 0);
+}
+
+TEST_CASE("cache_" "eviction", "[cache]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  Program_Cache<int64_t> c(4096, 1);
+  for (int i = 0; i < 1000; ++i)
+    c.get(p, (to_string(i) + " * 2").c_str());
+  auto st = c.stats();
+  CHECK(st.bytes <= 4096);
+  CHECK(st.entries > 0);
+  CHECK(st.evictions == 1000 - st.entries);
+  // the most recently used one survives
+  c.get(p, "999*2");
+  CHECK(c.stats().hits == 1);
+  c.get(p, "0*2");
+  CHECK(c.stats().hits == 1);
+}
+
+TEST_CASE("cache_" "concurrent", "[cache]" )
+{
+  auto g = make_shared<Grammar>();
+  g->operator_table().insert_default_arithmetic();
+  g->freeze();
+  Program_Cache<int64_t> c(1 << 16, 4);
+  vector<thread> ts;
+  vector<int> ok(4);
+  for (unsigned i = 0; i < ok.size(); ++i)
+    ts.emplace_back([&c, &ok, g, i] {
+        Parser p(g);
+        Evaluator<int64_t> e;
+        int n = 0;
+        for (int j = 0; j < 2000; ++j) {
+          int k = (j * 7 + i) % 100;
+          string s = to_string(k) + " + 1";
+          n += e.run(*c.get(p, s.c_str())) == k + 1;
+        }
+        ok[i] = n;
+        });
+  for (auto &t : ts)
+    t.join();
+  for (auto n : ok)
+    CHECK(n == 2000);
+  auto st = c.stats();
+  CHECK(st.hits + st.misses == 8000);
+  CHECK(st.entries <= 100);
+}
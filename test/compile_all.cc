@@ -0,0 +1,69 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include <catch/catch.hpp>
+
+#include <syard/compile_all.hh>
+#include <syard/eval.hh>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace syard;
+
+static shared_ptr<const Grammar> arithmetic()
+{
+  auto g = make_shared<Grammar>();
+  g->operator_table().insert_default_arithmetic();
+  g->function_table().insert("max", 20);
+  g->symbol_table().insert("x");
+  g->freeze();
+  return g;
+}
+
+TEST_CASE("compile_all_" "basic", "[compile_all]" )
+{
+  auto g = arithmetic();
+  vector<string> v;
+  for (unsigned i = 0; i < 1000; ++i)
+    v.push_back(i % 100 == 7 ? "1 + foo" : to_string(i) + " * (x + 1)");
+  for (unsigned threads : { 1, 3, 8 }) {
+    auto rs = compile_all<int64_t>(g, v, threads);
+    REQUIRE(rs.size() == v.size());
+    Evaluator<int64_t> e;
+    int64_t x = 2;
+    unsigned ok = 0;
+    for (unsigned i = 0; i < rs.size(); ++i) {
+      if (i % 100 == 7) {
+        CHECK_FALSE(rs[i].ok());
+        CHECK(rs[i].error == "unknown function/variable: foo");
+        CHECK(rs[i].program.empty());
+      } else {
+        ok += rs[i].ok() && e.run(rs[i].program, &x) == int64_t(i) * 3;
+      }
+    }
+    CHECK(ok == 990);
+  }
+}
+
+TEST_CASE("compile_all_" "small", "[compile_all]" )
+{
+  auto g = arithmetic();
+  CHECK(compile_all<double>(g, {}).empty());
+  auto rs = compile_all<double>(g, { "max(x, 2", "max(1, 2)" }, 4);
+  REQUIRE(rs.size() == 2);
+  CHECK_FALSE(rs[0].ok());
+  CHECK(rs[1].ok());
+  CHECK(rs[1].program.code().size() == 3);
+}
+
+TEST_CASE("compile_all_" "unfrozen grammar", "[compile_all]" )
+{
+  auto g = make_shared<Grammar>();
+  g->operator_table().insert_default_arithmetic();
+  vector<string> v(1000, "1 + 2");
+  CHECK_THROWS_AS(compile_all<double>(g, v, 4), std::invalid_argument);
+  CHECK_THROWS_AS(compile_all<double>(nullptr, v, 4), std::invalid_argument);
+  g->freeze();
+  CHECK(compile_all<double>(g, v, 4).size() == v.size());
+}
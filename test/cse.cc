@@ -0,0 +1,89 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include <catch/catch.hpp>
+
+#include <syard/cse.hh>
+#include <math.h>
+#include <vector>
+
+using namespace std;
+using namespace syard;
+
+static double twice(const double *args, unsigned)
+{
+  return 2 * args[0];
+}
+static int calls = 0;
+static double counter(const double *, unsigned)
+{
+  return ++calls;
+}
+
+TEST_CASE("cse_" "shared", "[cse]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.function_table().insert("twice", 20);
+  for (auto s : { "price", "qty", "vol" })
+    p.symbol_table().insert(s);
+  Evaluator<double> e;
+  e.insert(20, 1, twice, true);
+  vector<Program<double> > ps;
+  for (auto s : { "price*qty + 1", "(qty*price) / twice(vol)",
+      "twice(vol) - price*qty", "1" })
+    ps.push_back(p.compile<double>(s));
+  auto d = cse(ps, e);
+  // price qty * 1 + vol twice / -
+  CHECK(d.nodes().size() == 9);
+  CHECK(d.constants().size() == 1);
+  CHECK(d.variables() == 3);
+  REQUIRE(d.outputs().size() == 4);
+  CHECK(d.outputs()[3] == 3);
+
+  double vars[] = { 2, 3, 4 };
+  double out[4];
+  d.run(e, vars, out);
+  for (size_t i = 0; i < ps.size(); ++i)
+    CHECK(out[i] == e.run(ps[i], vars));
+}
+
+TEST_CASE("cse_" "impure", "[cse]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.function_table().insert("counter", 21);
+  Evaluator<double> e;
+  e.insert(21, 0, counter);
+  vector<Program<double> > ps;
+  ps.push_back(p.compile<double>("counter() + counter()"));
+  ps.push_back(p.compile<double>("0.0 - 1"));
+  ps.push_back(p.compile<double>("-0.0 - 1"));
+  auto d = cse(ps, e);
+  // i.e. each call is kept, and -0.0 isn't merged with 0.0
+  CHECK(d.nodes().size() == 8);
+  calls = 0;
+  double out[3];
+  vector<double> values;
+  d.run(e, nullptr, out, values);
+  CHECK(out[0] == 3);
+  CHECK(calls == 2);
+  CHECK(out[1] == -1);
+  CHECK(out[2] == -1);
+  CHECK(d.constants().size() == 3);
+  CHECK(values.size() == d.nodes().size());
+}
+
+TEST_CASE("cse_" "errors", "[cse]" )
+{
+  Program<int64_t> p;
+  p.push_constant(1);
+  p.push_constant(2);
+  Evaluator<int64_t> e;
+  CHECK_THROWS_AS(cse(vector<Program<int64_t> >{p}, e), std::underflow_error);
+  p.push_operator(PLUS, 2);
+  auto d = cse(vector<Program<int64_t> >{p, p}, e);
+  CHECK(d.nodes().size() == 3);
+  CHECK(d.outputs()[0] == d.outputs()[1]);
+  CHECK_THROWS_AS(cse(vector<Program<int64_t> >{Program<int64_t>()}, e),
+      std::underflow_error);
+}
@@ -0,0 +1,118 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include <catch/catch.hpp>
+
+#include <syard/eval.hh>
+#include <algorithm>
+#include <math.h>
+
+using namespace std;
+using namespace syard;
+
+TEST_CASE("eval_" "arithmetic", "[eval]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  Evaluator<int64_t> e;
+  CHECK(e.run(p.compile<int64_t>("1+2*3")) == 7);
+  CHECK(e.run(p.compile<int64_t>(" (1+2)*(2+3)*4^(2*3+4)+2 ")) == 15728642);
+  CHECK(e.run(p.compile<int64_t>("-2*-3*-4")) == -24);
+  CHECK(e.run(p.compile<int64_t>("7/2-10")) == -7);
+  CHECK(e.run(p.compile<int64_t>("2**3**2")) == 512);
+  CHECK(e.run(p.compile<int64_t>("-(1+2)*-(4)-(-(5))")) == 17);
+  CHECK_THROWS_AS(e.run(p.compile<int64_t>("1/0")), std::domain_error);
+  // i.e. without overflowing in between
+  CHECK(e.run(p.compile<int64_t>("2^62")) == int64_t(1) << 62);
+  CHECK(e.run(p.compile<int64_t>("3^39")) == 4052555153018976267);
+  CHECK(e.run(p.compile<int64_t>("-2^63")) == INT64_MIN);
+  CHECK_THROWS_AS(e.run(p.compile<int64_t>("3^40")), std::overflow_error);
+  CHECK_THROWS_AS(e.run(p.compile<int64_t>("2^63")), std::overflow_error);
+  CHECK_THROWS_AS(e.run(p.compile<int64_t>("10^100")), std::overflow_error);
+  CHECK(e.run(p.compile<int64_t>("-3^39")) == -4052555153018976267);
+  CHECK_THROWS_AS(e.run(p.compile<int64_t>("(0-9223372036854775807-1)/-1")),
+      std::overflow_error);
+  CHECK(power<int64_t>(-1, 63) == -1);
+  CHECK(divide<int64_t>(INT64_MIN, 1) == INT64_MIN);
+
+  Evaluator<double> d;
+  CHECK(d.run(p.compile<double>("7/2-10")) == -6.5);
+  CHECK(d.run(p.compile<double>("2^.5")) == sqrt(2.0));
+}
+
+TEST_CASE("eval_" "functions", "[eval]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  auto &f = p.function_table();
+  f.insert("sqrt", 20);
+  f.insert("max", 21);
+  f.insert("pi", 22);
+  f.insert("zoo", 23);
+  Evaluator<double> e;
+  e.insert(20, 1, [](const double *a, unsigned) { return sqrt(a[0]); });
+  e.insert(21, Evaluator<double>::VARIADIC, [](const double *a, unsigned n) {
+      return *max_element(a, a + n); });
+  e.insert(22, 0, [](const double *, unsigned) { return 3.0; });
+  CHECK(e.run(p.compile<double>("sqrt(16) * max(1, 7, 3) + pi()")) == 31.0);
+  CHECK(e.run(p.compile<double>("max(2)")) == 2.0);
+  CHECK_THROWS_AS(e.run(p.compile<double>("sqrt(1, 2)")),
+      std::invalid_argument);
+  CHECK_THROWS_AS(e.run(p.compile<double>("zoo(1)")), std::range_error);
+  CHECK_THROWS_AS(e.insert(5, 1, nullptr), std::invalid_argument);
+}
+
+TEST_CASE("eval_" "reductions", "[eval]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  auto &f = p.function_table();
+  f.insert("max", 20, 1, Function_Table::VARIADIC);
+  f.insert("sum", 21);
+  Evaluator<int64_t> e;
+  e.insert_reduction(20, [](int64_t a, int64_t b) { return max(a, b); },
+      true);
+  e.insert_reduction(21, [](int64_t a, int64_t b) { return a + b; });
+  CHECK(e.run(p.compile<int64_t>("max(3, 9, 2, 4) * 2")) == 18);
+  CHECK(e.run(p.compile<int64_t>("max(-5)")) == -5);
+  CHECK(e.run(p.compile<int64_t>("sum(1, 2, 3, 4, 5) - 1")) == 14);
+  // i.e. only a function declared with a min arity of 1 is safe
+  CHECK_THROWS_AS(e.run(p.compile<int64_t>("sum()")),
+      std::invalid_argument);
+  CHECK_THROWS_AS(p.compile<int64_t>("max()"), std::invalid_argument);
+  CHECK(e.pure(20));
+  CHECK(!e.pure(21));
+  CHECK_THROWS_AS(e.insert_reduction(5, nullptr), std::invalid_argument);
+}
+
+TEST_CASE("eval_" "deep stack", "[eval]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  string s;
+  for (unsigned i = 0; i < 100; ++i)
+    s += "1+(";
+  s += "1";
+  s += string(100, ')');
+  auto prog = p.compile<int64_t>(s.c_str());
+  CHECK(prog.max_depth() > Evaluator<int64_t>::MAX_STACK);
+  Evaluator<int64_t> e;
+  CHECK(e.run(prog) == 101);
+  CHECK_THROWS_AS(e.run(Program<int64_t>()), std::underflow_error);
+}
+
+TEST_CASE("eval_" "variables", "[eval]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  auto &s = p.symbol_table();
+  s.insert("price");
+  s.insert("qty");
+  s.insert("fee");
+  auto prog = p.compile<double>("price * qty - fee");
+  Evaluator<double> e;
+  double vars[] = { 2.5, 4, 1 };
+  CHECK(e.run(prog, vars) == 9);
+  vars[2] = 2;
+  CHECK(e.run(prog, vars) == 8);
+  CHECK_THROWS_AS(e.run(prog), std::invalid_argument);
+}
@@ -0,0 +1,158 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include <catch/catch.hpp>
+
+#include <syard/jit.hh>
+#include <syard/serialize.hh>
+#include <algorithm>
+#include <math.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace syard;
+
+static void functions(Parser &p, Evaluator<double> &e)
+{
+  p.operator_table().insert_default_arithmetic();
+  auto &f = p.function_table();
+  f.insert("sqrt", 20);
+  f.insert("max", 21);
+  f.insert("pi", 22);
+  f.insert("rnd", 23);
+  f.insert("chk", 24);
+  for (auto s : { "a", "b", "c", "d" })
+    p.symbol_table().insert(s);
+  e.insert(20, 1, [](const double *a, unsigned) { return sqrt(a[0]); },
+      true);
+  e.insert(21, Evaluator<double>::VARIADIC, [](const double *a, unsigned n) {
+      return *max_element(a, a + n); }, true);
+  e.insert(22, 0, [](const double *, unsigned) { return M_PI; }, true);
+  e.insert(23, 0, [](const double *, unsigned) { return 4.0; });
+  e.insert(24, 1, [](const double *a, unsigned) {
+      if (a[0] < 0)
+        throw std::domain_error("negative");
+      return a[0]; }, true);
+}
+
+TEST_CASE("jit_" "same as interpreter", "[jit]" )
+{
+  Parser p;
+  Evaluator<double> e;
+  functions(p, e);
+  double vars[] = { 1.5, -2, 3.25, 1e10 };
+  for (auto s : { "1 + 2 * 3", "a * b - c / d", "7 / 0", "-2 ** a",
+      "2 ^ 3 ^ 0.5 * a", "(a + b) * (c - d) / (a * b + c * d) - 1",
+      "sqrt(c * 4) + max(a, b, c, d) * pi()", "max(1, 2 ^ a, 3 * b)",
+      "a + (b + (c + (d + (a + (b + (c + (d + 1)))))))",
+      "max(sqrt(a), 1, max(2, sqrt(c)), pi() ^ 2) + a", "pi()", "a",
+      "chk(c) * 2", "-a", "-(a * 0)", "-(a + b) * -c",
+      "-sqrt(c) - -max(a, b, -d)",
+      "a + (b + (c + (d + (a + (b + (c + (d + (a - -(b + c)))))))))" }) {
+    INFO(s);
+    auto prog = p.compile<double>(s);
+    auto c = Jit_Code::compile(prog, e);
+#if SYARD_JIT
+    REQUIRE(c);
+    CHECK(c->size() > 0);
+    double x = e.run(prog, vars);
+    double y = c->run(vars);
+    if (isnan(x))
+      CHECK(isnan(y));
+    else
+      CHECK(x == y);
+    // i.e. -0.0
+    CHECK(signbit(x) == signbit(y));
+#else
+    CHECK(!c);
+#endif
+  }
+}
+
+TEST_CASE("jit_" "fallback", "[jit]" )
+{
+  Parser p;
+  Evaluator<double> e;
+  functions(p, e);
+  // i.e. impure
+  CHECK(!Jit_Code::compile(p.compile<double>("rnd() + 1"), e));
+  CHECK(!Jit_Code::compile(Program<double>(), e));
+  string s;
+  for (unsigned i = 0; i < Jit_Code::MAX_DEPTH; ++i)
+    s += "1+(";
+  s += "1" + string(Jit_Code::MAX_DEPTH, ')');
+  auto deep = p.compile<double>(s.c_str());
+  CHECK(deep.max_depth() > Jit_Code::MAX_DEPTH);
+  CHECK(!Jit_Code::compile(deep, e));
+
+  Tiered_Program t(deep, e, 2);
+  for (unsigned i = 0; i < 5; ++i)
+    CHECK(t.run() == Jit_Code::MAX_DEPTH + 1);
+  CHECK(!t.native());
+}
+
+TEST_CASE("jit_" "exceptions", "[jit]" )
+{
+  Parser p;
+  Evaluator<double> e;
+  functions(p, e);
+  auto c = Jit_Code::compile(p.compile<double>("1 + chk(a) * sqrt(a, b)"),
+      e);
+#if SYARD_JIT
+  REQUIRE(c);
+  double vars[] = { -1, 1, 1, 1 };
+  // i.e. the first one wins, like in the interpreter
+  CHECK_THROWS_AS(c->run(vars), std::domain_error);
+  vars[0] = 1;
+  CHECK_THROWS_AS(c->run(vars), std::invalid_argument);
+  CHECK_THROWS_AS(c->run(), std::invalid_argument);
+#else
+  CHECK(!c);
+#endif
+}
+
+TEST_CASE("jit_" "tiered", "[jit]" )
+{
+  Parser p;
+  Evaluator<double> e;
+  functions(p, e);
+  double vars[] = { 1, 2, 3, 4 };
+  Tiered_Program t(p.compile<double>("a * b + max(c, d)"), e, 3);
+  for (unsigned i = 0; i < 2; ++i)
+    CHECK(t.run(vars) == 6);
+  CHECK(!t.native());
+  CHECK(t.run(vars) == 6);
+#if SYARD_JIT
+  CHECK(t.native());
+#endif
+  CHECK(t.run(vars) == 6);
+  CHECK(t.runs() == 3);
+
+  Tiered_Program u(p.compile<double>("a - 1"), e, 0);
+#if SYARD_JIT
+  CHECK(u.native());
+#endif
+  CHECK(u.run(vars) == 0);
+}
+
+TEST_CASE("jit_" "program view", "[jit]" )
+{
+  Parser p;
+  Evaluator<double> e;
+  functions(p, e);
+  vector<Program<double> > ps { p.compile<double>("(a + 2) * 1.5") };
+  auto s = serialize(p.grammar(), ps);
+  vector<uint64_t> v((s.size() + 7) / 8);
+  memcpy(v.data(), s.data(), s.size());
+  auto b = reinterpret_cast<const char*>(v.data());
+  Program_File<double> f(b, b + s.size(), p.grammar());
+  auto c = Jit_Code::compile(f[0], e);
+  double vars[] = { 2, 0, 0, 0 };
+#if SYARD_JIT
+  REQUIRE(c);
+  CHECK(c->run(vars) == 6);
+#else
+  CHECK(!c);
+#endif
+}
@@ -0,0 +1,59 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include <catch/catch.hpp>
+
+#include <syard/number.hh>
+#include <locale.h>
+#include <stdexcept>
+#include <string.h>
+
+using namespace std;
+using namespace syard;
+
+template <typename T> static T num(const char *s, bool negative = false)
+{
+  return parse_number<T>(s, s + strlen(s), negative);
+}
+
+TEST_CASE("number_" "int", "[number]" )
+{
+  CHECK(num<int64_t>("0") == 0);
+  CHECK(num<int64_t>("42") == 42);
+  CHECK(num<int64_t>("42", true) == -42);
+  CHECK(num<int64_t>("9223372036854775807") == INT64_MAX);
+  CHECK(num<int64_t>("9223372036854775808", true) == INT64_MIN);
+  CHECK_THROWS_AS(num<int64_t>("9223372036854775808"), std::overflow_error);
+  CHECK_THROWS_AS(num<int64_t>("1.5"), std::range_error);
+  CHECK_THROWS_AS(num<int64_t>(""), std::range_error);
+}
+
+TEST_CASE("number_" "double", "[number]" )
+{
+  CHECK(num<double>("0") == 0.0);
+  CHECK(num<double>("23") == 23.0);
+  CHECK(num<double>("0.22") == 0.22);
+  CHECK(num<double>(".42") == 0.42);
+  CHECK(num<double>("1.") == 1.0);
+  CHECK(num<double>("0.1", true) == -0.1);
+  CHECK(num<double>("3.141592653589793") == 3.141592653589793);
+  CHECK(num<double>("123456789012345678901234567890")
+      == 123456789012345678901234567890.0);
+  CHECK(num<double>("0.000000000000000000000000000001") == 1e-30);
+  CHECK_THROWS_AS(num<double>("."), std::range_error);
+  CHECK_THROWS_AS(num<double>("1.2.3"), std::range_error);
+}
+
+TEST_CASE("number_" "locale", "[number]" )
+{
+  // i.e. the slow path must not use the decimal comma
+  const char *ls[] = { "de_DE.UTF-8", "de_DE", "fr_FR.UTF-8", "fr_FR" };
+  bool comma = false;
+  for (auto l : ls)
+    if ((comma = setlocale(LC_NUMERIC, l)))
+      break;
+  CHECK(num<double>("0.000000000000000000000000000001") == 1e-30);
+  CHECK(num<double>("123456789012345678901.5") == 123456789012345678901.5);
+  setlocale(LC_NUMERIC, "C");
+  if (!comma)
+    WARN("no decimal comma locale available");
+}
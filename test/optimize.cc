@@ -0,0 +1,106 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include <catch/catch.hpp>
+
+#include <syard/optimize.hh>
+#include <math.h>
+
+using namespace std;
+using namespace syard;
+
+TEST_CASE("optimize_" "fold", "[optimize]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  Evaluator<int64_t> e;
+  Optimize_Report r;
+  auto q = optimize(p.compile<int64_t>(" (1+2)*(2+3)*4^(2*3+4)+2 "), e, &r);
+  REQUIRE(q.code().size() == 1);
+  CHECK(q.constants()[q.code()[0].arg] == 15728642);
+  CHECK(r.before == 17);
+  CHECK(r.after == 1);
+  CHECK(r.folded == 8);
+  CHECK(q.max_depth() == 1);
+}
+
+TEST_CASE("optimize_" "partial", "[optimize]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.symbol_table().insert("x");
+  p.symbol_table().insert("y");
+  Evaluator<int64_t> e;
+  Optimize_Report r;
+  auto q = optimize(p.compile<int64_t>("x*4^(2*3+4) - y/(2-2)"), e, &r);
+  // 1/0 isn't folded
+  CHECK(r.after == 7);
+  int64_t vars[] = { 2, 3 };
+  CHECK_THROWS_AS(e.run(q, vars), std::domain_error);
+  q = optimize(p.compile<int64_t>("x*4^(2*3+4) - y/(2-1)"), e, &r);
+  CHECK(r.after == 5);
+  CHECK(e.run(q, vars) == 2097149);
+}
+
+TEST_CASE("optimize_" "identities", "[optimize]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.symbol_table().insert("x");
+  p.symbol_table().insert("y");
+  Evaluator<int64_t> e;
+  Optimize_Report r;
+  auto q = optimize(p.compile<int64_t>("x*1+0"), e, &r);
+  CHECK(q.code().size() == 1);
+  CHECK(q.code()[0].code == VARIABLE);
+  CHECK(r.simplified == 2);
+  q = optimize(p.compile<int64_t>("(0+1*(x-0))/1^1*y**(3-2)"), e, &r);
+  CHECK(r.after == 3);
+  int64_t vars[] = { 6, 7 };
+  CHECK(e.run(q, vars) == 42);
+
+  // -0.0 + 0.0 == +0.0
+  Evaluator<double> d;
+  auto s = optimize(p.compile<double>("x+0"), d, &r);
+  CHECK(r.after == 3);
+  double dv[] = { -0.0, 0 };
+  CHECK(!signbit(d.run(s, dv)));
+  s = optimize(p.compile<double>("1*x*1-0"), d, &r);
+  CHECK(r.after == 1);
+  CHECK(signbit(d.run(s, dv)));
+  // -0.0 - -0.0 == +0.0
+  s = optimize(p.compile<double>("x-(0*-1)"), d, &r);
+  CHECK(r.folded == 1);
+  CHECK(r.after == 3);
+  CHECK(!signbit(d.run(s, dv)));
+  s = optimize(p.compile<double>("x-(0*1)"), d, &r);
+  CHECK(r.after == 1);
+  CHECK(signbit(d.run(s, dv)));
+
+  // i.e. -(-x) == x, also for -0.0
+  s = optimize(p.compile<double>("-(-(x))"), d, &r);
+  CHECK(r.before == 3);
+  CHECK(r.after == 1);
+  CHECK(signbit(d.run(s, dv)));
+  s = optimize(p.compile<double>("-(2+3)*-x"), d, &r);
+  CHECK(r.after == 4);
+  dv[0] = 2;
+  CHECK(d.run(s, dv) == 10);
+}
+
+TEST_CASE("optimize_" "pure functions", "[optimize]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.function_table().insert("sqrt", 20);
+  p.function_table().insert("rnd", 21);
+  Evaluator<double> e;
+  e.insert(20, 1, [](const double *a, unsigned) { return sqrt(a[0]); },
+      true);
+  e.insert(21, 0, [](const double *, unsigned) { return 4.0; });
+  Optimize_Report r;
+  auto q = optimize(p.compile<double>("sqrt(16)*rnd()+sqrt(rnd())"), e, &r);
+  CHECK(r.before == 7);
+  CHECK(r.folded == 1);
+  CHECK(r.after == 6);
+  CHECK(e.run(q) == 18.0);
+}
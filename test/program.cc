@@ -0,0 +1,211 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include <catch/catch.hpp>
+
+#include <syard/syard.hh>
+#include <syard/program.hh>
+#include <string>
+#include <vector>
+#include <math.h>
+
+using namespace std;
+using namespace syard;
+
+static void eval(Stack<string> &o, uint8_t id)
+{
+  auto b = stol(o.top()); o.pop();
+  auto a = stol(o.top()); o.pop();
+  long c = 0;
+  switch (id) {
+    case POWER: c = pow(a, b); break;
+    case MULT : c = a * b; break;
+    case PLUS : c = a + b; break;
+    case MINUS: c = a - b; break;
+  }
+  o.push(to_string(c));
+}
+
+TEST_CASE("program_" "rpn", "[program][compile]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  auto prog = p.compile("1+2*3");
+  auto &c = prog.code();
+  REQUIRE(c.size() == 5);
+  CHECK(c[0].code == OPERAND);
+  CHECK(prog.constants()[c[0].arg] == "1");
+  CHECK(c[1].code == OPERAND);
+  CHECK(c[2].code == OPERAND);
+  CHECK(c[3].code == MULT);
+  CHECK(c[3].argc == 2);
+  CHECK(c[4].code == PLUS);
+  CHECK(c[4].argc == 2);
+  CHECK(prog.max_depth() == 3);
+}
+
+TEST_CASE("program_" "run many times", "[program][compile]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  auto prog = p.compile(" (1+2)*(2+3)*4^(2*3+4)+2 ");
+  for (unsigned i = 0; i < 3; ++i) {
+    Stack<string> o;
+    prog.run(o, [&o](uint8_t id) { eval(o, id); });
+    CHECK(o.top() == "15728642");
+    CHECK(o.size() == 1);
+  }
+}
+
+TEST_CASE("program_" "sign", "[program][compile]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  auto prog = p.compile("-2*-3*-4");
+  CHECK(prog.constants().size() == 3);
+  CHECK(prog.constants()[0] == "-2");
+  Stack<string> o;
+  prog.run(o, [&o](uint8_t id) { eval(o, id); });
+  CHECK(o.top() == "-24");
+}
+
+TEST_CASE("program_" "function arity", "[program][compile]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  auto &f = p.function_table();
+  f.insert("max", 20);
+  f.insert("pi", 21);
+  f.insert("neg", 22);
+  auto prog = p.compile("max(1, 2, 3*4) + pi() + neg(2)");
+  auto &c = prog.code();
+  REQUIRE(c.size() == 11);
+  CHECK(c[5].code == 20);
+  CHECK(c[5].argc == 3);
+  CHECK(c[6].code == 21);
+  CHECK(c[6].argc == 0);
+  CHECK(c[7].code == PLUS);
+  CHECK(c[9].code == 22);
+  CHECK(c[9].argc == 1);
+  CHECK(c[10].code == PLUS);
+  CHECK(prog.max_depth() == 4);
+}
+
+TEST_CASE("program_" "throws", "[program][compile]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  CHECK_THROWS_AS(p.compile("(-2*(-3*-4)"), std::underflow_error);
+  CHECK_THROWS_AS(p.compile("1+"), std::underflow_error);
+  auto prog = p.compile("1+2");
+  CHECK(prog.code().size() == 3);
+}
+
+TEST_CASE("program_" "try compile", "[program][compile]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.symbol_table().insert("x");
+  Program<double> prog;
+  auto e = p.try_compile("1 + * 2", "1 + * 2" + 7, prog);
+  CHECK(e.code == ERR_MISSING_OPERAND);
+  CHECK(e.offset == 7);
+  const char s[] = "2 * -x";
+  e = p.try_compile(s, s + 6, prog);
+  CHECK_FALSE(e);
+  CHECK(prog.code().size() == 4);
+  CHECK(prog.code()[2].code == NEGATE);
+  e = p.try_compile(s, s + 1, prog);
+  CHECK(e.code == ERR_NONE);
+  CHECK(prog.code().size() == 1);
+  CHECK(prog.constants().front() == 2);
+  e = p.try_compile(s + 5, s + 6, prog);
+  CHECK_FALSE(e);
+  CHECK(prog.code().size() == 1);
+  CHECK(prog.variables() == 1);
+}
+
+TEST_CASE("program_" "typed constants", "[program][compile]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  auto prog = p.compile<double>("-2.5*-- 4");
+  REQUIRE(prog.constants().size() == 2);
+  CHECK(prog.constants()[0] == -2.5);
+  CHECK(prog.constants()[1] == 4.0);
+  CHECK_THROWS_AS(p.compile<int64_t>("2.5*4"), std::range_error);
+}
+
+TEST_CASE("program_" "variables", "[program][compile]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  auto &s = p.symbol_table();
+  s.insert("price");
+  s.insert("qty");
+  s.insert("fee");
+  auto prog = p.compile<double>("price * qty - fee - 1");
+  auto &c = prog.code();
+  REQUIRE(c.size() == 7);
+  CHECK(c[0].code == VARIABLE);
+  CHECK(c[0].arg == 0);
+  CHECK(c[1].code == VARIABLE);
+  CHECK(c[1].arg == 1);
+  CHECK(c[3].code == VARIABLE);
+  CHECK(c[3].arg == 2);
+  CHECK(prog.variables() == 3);
+  CHECK(prog.constants().size() == 1);
+
+  Stack<double> o;
+  CHECK_THROWS_AS(prog.run(o, [](uint8_t) {}), std::range_error);
+}
+
+TEST_CASE("program_" "negate", "[program][compile]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.function_table().insert("max", 20);
+  p.symbol_table().insert("x");
+  struct Case {
+    const char *inp;
+    vector<uint8_t> codes;
+  };
+  Case cases[] = {
+    // i.e. signs of numbers are still folded into the constant
+    { "-2 * 3"          , { OPERAND, OPERAND, MULT } },
+    { "-x"              , { VARIABLE, NEGATE } },
+    { "--x"             , { VARIABLE } },
+    { "---x * 2"        , { VARIABLE, NEGATE, OPERAND, MULT } },
+    { "-(1 + x)"        , { OPERAND, VARIABLE, PLUS, NEGATE } },
+    { "2 ^ -(x)"        , { OPERAND, VARIABLE, NEGATE, POWER } },
+    { "-max(x, -x) - 1" , { VARIABLE, VARIABLE, NEGATE, 20, NEGATE,
+                            OPERAND, MINUS } },
+    { "-(-(x))"         , { VARIABLE, NEGATE, NEGATE } },
+    { "--(x)"           , { VARIABLE } }
+  };
+  for (auto &c : cases) {
+    INFO(c.inp);
+    auto prog = p.compile<int64_t>(c.inp);
+    vector<uint8_t> codes;
+    for (auto &i : prog.code()) {
+      codes.push_back(i.code);
+      if (i.code == NEGATE)
+        CHECK(i.argc == 1);
+    }
+    CHECK(codes == c.codes);
+  }
+
+  vector<uint8_t> ids;
+  Stack<int64_t> o;
+  p.parse("-(2 + 3) * 4", o, [&o, &ids](uint8_t id, unsigned argc) {
+      ids.push_back(id);
+      auto b = o.top(); o.pop();
+      if (argc == 1) {
+        o.push(id == NEGATE ? -b : b);
+        return;
+      }
+      auto a = o.top(); o.pop();
+      o.push(id == PLUS ? a + b : a * b);
+      });
+  CHECK(ids == vector<uint8_t>({ PLUS, NEGATE, MULT }));
+  CHECK(o.top() == -20);
+}
@@ -0,0 +1,55 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include <catch/catch.hpp>
+
+#include <syard/scan.hh>
+#include <string>
+#include <string.h>
+
+using namespace std;
+using namespace syard;
+
+// compare the vectorized kernels against the scalar ones for class runs
+// of all lengths/alignments up to a few vector widths
+TEST_CASE("scan_" "kernels", "[scan]" )
+{
+  const Scan_Kernels *ref = scan_kernels(SCAN_SCALAR);
+  REQUIRE(ref);
+  const char *fill[] = { " \t\n\r", "0123456789.", "abcxyz_" };
+  const char stop[] = { 'x', ',', '0', '\0', '\xe2', '\x80', '-' };
+  for (auto isa : { SCAN_SSE2, SCAN_AVX2 }) {
+    const Scan_Kernels *k = scan_kernels(isa);
+    if (!k)
+      continue;
+    for (unsigned c = 0; c < 3; ++c) {
+      auto f = c == 0 ? k->space : c == 1 ? k->number : k->name;
+      auto g = c == 0 ? ref->space : c == 1 ? ref->number : ref->name;
+      for (size_t off = 0; off < 4; ++off)
+        for (size_t n = 0; n < 100; ++n)
+          for (char x : stop) {
+            string s(off, '#');
+            for (size_t i = 0; i < n; ++i)
+              s += fill[c][i % strlen(fill[c])];
+            s += x;
+            s += string(40, fill[c][0]);
+            auto b = s.data() + off;
+            auto e = s.data() + s.size();
+            CHECK(f(b, e) == g(b, e));
+            CHECK(f(b, b + n) == b + n);
+          }
+    }
+  }
+}
+
+TEST_CASE("scan_" "dispatch", "[scan]" )
+{
+  CHECK(scan_kernels(best_scan_isa()) != nullptr);
+  const char inp[] = "  \t\t  \n  12345678901234567890.5 abc_def";
+  auto e = inp + sizeof(inp) - 1;
+  auto p = skip_space(inp, e);
+  CHECK(p == inp + 9);
+  auto q = scan_number(p, e);
+  CHECK(q == p + 22);
+  CHECK(scan_name(q, e) == q);
+  CHECK(scan_name(q + 1, e) == e);
+}
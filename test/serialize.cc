@@ -0,0 +1,186 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include <catch/catch.hpp>
+
+#include <syard/serialize.hh>
+#include <syard/batch.hh>
+#include <syard/eval.hh>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace syard;
+
+static double max2(const double *a, unsigned argc)
+{
+  double r = a[0];
+  for (unsigned i = 1; i < argc; ++i)
+    r = max(r, a[i]);
+  return r;
+}
+
+static void arithmetic(Parser &p)
+{
+  p.operator_table().insert_default_arithmetic();
+  p.function_table().insert("max", 20);
+  p.symbol_table().insert("x");
+  p.symbol_table().insert("y");
+}
+
+// i.e. 8 byte aligned
+static vector<uint64_t> aligned(const string &s)
+{
+  vector<uint64_t> v((s.size() + 7) / 8);
+  memcpy(v.data(), s.data(), s.size());
+  return v;
+}
+
+static const char *exprs[] = {
+  "1 + 2 * 3", "max(x, y * 2, 3.5) - x / 4", "x", "2 ** 0.5", "max(7)",
+  "-(x + y) * -max(x, 1)"
+};
+
+TEST_CASE("serialize_" "round trip", "[serialize]" )
+{
+  Parser p;
+  arithmetic(p);
+  vector<Program<double> > ps;
+  for (auto s : exprs)
+    ps.push_back(p.compile<double>(s));
+  ps.emplace_back();
+  auto s = serialize(p.grammar(), ps);
+  CHECK(s.size() % 8 == 0);
+  auto v = aligned(s);
+  auto b = reinterpret_cast<const char*>(v.data());
+
+  // i.e. another process that builds the same grammar
+  Parser q;
+  arithmetic(q);
+  Program_File<double> f(b, b + s.size(), q.grammar());
+  REQUIRE(f.size() == ps.size());
+  CHECK(f.variables() == 2);
+  Evaluator<double> ev;
+  ev.insert(20, Evaluator<double>::VARIADIC, max2);
+  Batch_Evaluator<double> bev;
+  double vars[] = { 3, 5 };
+  for (size_t i = 0; i + 1 < ps.size(); ++i) {
+    INFO(exprs[i]);
+    auto &v = f[i];
+    CHECK(v.code().size() == ps[i].code().size());
+    CHECK(v.max_depth() == ps[i].max_depth());
+    CHECK(v.variables() == ps[i].variables());
+    // i.e. in place
+    CHECK(v.code().data() >= reinterpret_cast<const Instruction*>(b));
+    CHECK(ev.run(v, vars) == ev.run(ps[i], vars));
+    if (i == 0) {
+      double out[3];
+      bev.run(v, nullptr, out, 3);
+      CHECK(out[2] == 7);
+    }
+  }
+  CHECK(f[ps.size() - 1].empty());
+  CHECK_THROWS_AS(ev.run(f[ps.size() - 1]), std::underflow_error);
+
+  // the Grammar (i.e. not the insert order) matters
+  Parser r;
+  r.function_table().insert("max", 20);
+  r.symbol_table().insert("x");
+  r.symbol_table().insert("y");
+  r.operator_table().insert_default_arithmetic();
+  CHECK(r.grammar().fingerprint() == p.grammar().fingerprint());
+  CHECK(Program_File<double>(b, b + s.size(), r.grammar()).size()
+      == ps.size());
+}
+
+TEST_CASE("serialize_" "reject", "[serialize]" )
+{
+  Parser p;
+  arithmetic(p);
+  vector<Program<double> > ps;
+  for (auto s : exprs)
+    ps.push_back(p.compile<double>(s));
+  auto s = serialize(p.grammar(), ps);
+  auto load = [](const string &s, const Grammar &g) {
+    auto v = aligned(s);
+    auto b = reinterpret_cast<const char*>(v.data());
+    Program_File<double> f(b, b + s.size(), g);
+    return f.size();
+  };
+  CHECK(load(s, p.grammar()) == ps.size());
+
+  {
+    Parser q;
+    arithmetic(q);
+    q.function_table().insert("min", 21);
+    CHECK_THROWS_AS(load(s, q.grammar()), std::runtime_error);
+  }
+  {
+    Parser q;
+    arithmetic(q);
+    q.operator_table().insert("%", 15, 9, true);
+    CHECK_THROWS_AS(load(s, q.grammar()), std::runtime_error);
+  }
+  {
+    // i.e. other slots
+    Parser q;
+    q.symbol_table().insert("y");
+    arithmetic(q);
+    CHECK_THROWS_AS(load(s, q.grammar()), std::runtime_error);
+  }
+  {
+    auto v = aligned(s);
+    auto b = reinterpret_cast<const char*>(v.data());
+    CHECK_THROWS_AS(Program_File<int64_t>(b, b + s.size(), p.grammar()),
+        std::runtime_error);
+  }
+  CHECK_THROWS_AS(load(s.substr(0, 20), p.grammar()), std::runtime_error);
+  CHECK_THROWS_AS(load(s.substr(0, s.size() - 16), p.grammar()),
+      std::runtime_error);
+  CHECK_THROWS_AS(load("hello world", p.grammar()), std::runtime_error);
+  {
+    // an operand index out of range
+    auto t = s;
+    size_t o;
+    memcpy(&o, &t[sizeof(impl::File_Header)], sizeof o);
+    t[o + sizeof(impl::Record_Header) + 2] = 42;
+    CHECK_THROWS_AS(load(t, p.grammar()), std::runtime_error);
+  }
+  {
+    // an operator without operands
+    auto t = s;
+    size_t o;
+    memcpy(&o, &t[sizeof(impl::File_Header)], sizeof o);
+    t[o + sizeof(impl::Record_Header)] = MULT;
+    t[o + sizeof(impl::Record_Header) + 1] = 2;
+    CHECK_THROWS_AS(load(t, p.grammar()), std::runtime_error);
+  }
+}
+
+TEST_CASE("serialize_" "file", "[serialize]" )
+{
+  Parser p;
+  arithmetic(p);
+  vector<Program<int64_t> > ps;
+  ps.push_back(p.compile<int64_t>("(x + 1) * y"));
+  char name[] = "/tmp/syard_serialize_XXXXXX";
+  int fd = mkstemp(name);
+  REQUIRE(fd != -1);
+  close(fd);
+  save(name, p.grammar(), ps);
+  {
+    Program_File<int64_t> f(name, p.grammar());
+    REQUIRE(f.size() == 1);
+    Evaluator<int64_t> ev;
+    int64_t vars[] = { 2, 5 };
+    CHECK(ev.run(f[0], vars) == 15);
+  }
+  unlink(name);
+  CHECK_THROWS_AS(Program_File<int64_t>(name, p.grammar()),
+      std::system_error);
+  CHECK_THROWS_AS(save("/nonexistent/syard", p.grammar(), ps),
+      std::system_error);
+}
@@ -0,0 +1,124 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include <catch/catch.hpp>
+
+#include <syard/sheet.hh>
+#include <string>
+
+using namespace std;
+using namespace syard;
+
+static int ticks = 0;
+static double tick(const double *, unsigned)
+{
+  return ++ticks;
+}
+
+TEST_CASE("sheet_" "dirty cone", "[sheet]" )
+{
+  Sheet<double> s;
+  s.parser().operator_table().insert_default_arithmetic();
+  s.define("total", "price * qty");
+  s.define("net", "total - fee");
+  s.define("other", "bonus * 2");
+  s.set("price", 2);
+  s.set("qty", 3);
+  s.set("fee", 1);
+  s.set("bonus", 5);
+  s.recompute();
+  CHECK(s.get("total") == 6);
+  CHECK(s.get("net") == 5);
+  CHECK(s.get("other") == 10);
+  CHECK(s.stats().last == 3);
+
+  // i.e. only total and net
+  s.set("qty", 4);
+  s.recompute();
+  CHECK(s.get("net") == 7);
+  CHECK(s.stats().last == 2);
+
+  // batched
+  s.set("price", 3);
+  s.set("qty", 5);
+  s.set("fee", 2);
+  s.recompute();
+  CHECK(s.get("net") == 13);
+  CHECK(s.stats().last == 2);
+
+  // total doesn't change, thus net isn't evaluated
+  s.set("price", 5);
+  s.set("qty", 3);
+  s.recompute();
+  CHECK(s.stats().last == 1);
+
+  s.recompute();
+  CHECK(s.stats().last == 0);
+  CHECK(s.stats().recomputes == 5);
+  CHECK(s.stats().evaluated == 8);
+  CHECK(s.stats().updates == 10);
+  CHECK(s.deps(s.slot("net")).size() == 2);
+}
+
+TEST_CASE("sheet_" "redefine", "[sheet]" )
+{
+  Sheet<int64_t> s;
+  s.parser().operator_table().insert_default_arithmetic();
+  s.define("b", "a + 1");
+  s.define("c", "b * 2");
+  s.set("a", 1);
+  s.recompute();
+  CHECK(s.get("c") == 4);
+  CHECK_THROWS_AS(s.define("a", "c + 1"), std::invalid_argument);
+  CHECK_THROWS_AS(s.define("b", "b"), std::invalid_argument);
+  CHECK_THROWS_AS(s.set("b", 3), std::logic_error);
+  s.define("b", "a + 10");
+  s.recompute();
+  CHECK(s.get("c") == 22);
+  // i.e. a doesn't affect b anymore
+  s.define("b", "d");
+  s.set("a", 7);
+  s.recompute();
+  CHECK(s.get("c") == 0);
+  CHECK(s.stats().last == 2);
+  s.set("a", 8);
+  s.recompute();
+  CHECK(s.stats().last == 0);
+  CHECK_THROWS_AS(s.define("e", "1 +"), std::underflow_error);
+  CHECK_THROWS_AS(s.get("nope"), std::range_error);
+}
+
+TEST_CASE("sheet_" "functions", "[sheet]" )
+{
+  Sheet<double> s;
+  s.parser().operator_table().insert_default_arithmetic();
+  s.parser().function_table().insert("tick", 20);
+  s.evaluator().insert(20, 0, tick);
+  s.define("t", "tick() + x");
+  s.define("y", "x * 2");
+  ticks = 0;
+  s.recompute();
+  s.recompute();
+  CHECK(s.get("t") == 2);
+  CHECK(s.stats().last == 1);
+  REQUIRE(s.functions(s.slot("t")).size() == 1);
+  s.touch(20);
+  s.recompute();
+  CHECK(s.stats().last == 1);
+
+  // on error, the remaining cells stay dirty
+  s.parser().function_table().insert("inv", 21);
+  s.evaluator().insert(21, 1, [](const double *a, unsigned) {
+      if (!a[0])
+        throw std::domain_error("inverse of zero");
+      return 1 / a[0];
+      }, true);
+  s.define("z", "inv(x)");
+  CHECK_THROWS_AS(s.recompute(), std::domain_error);
+  s.set("x", 4);
+  s.recompute();
+  CHECK(s.get("z") == 0.25);
+  CHECK(s.get("y") == 8);
+
+  // i.e. a misspelled function isn't an input cell followed by a group
+  CHECK_THROWS_AS(s.define("a", "inc(3)"), std::underflow_error);
+}
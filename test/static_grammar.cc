@@ -0,0 +1,126 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include <catch/catch.hpp>
+
+#include <syard/static_grammar.hh>
+#include <syard/eval.hh>
+#include <string.h>
+#include <string>
+
+using namespace std;
+using namespace syard;
+
+using Arithmetic = Static_Grammar<Default_Arithmetic, Functions<
+  Static_Function<20, 'm', 'a', 'x'>,
+  Static_Function<21, 'm', 'a', 'x', 'x'>
+  > >;
+
+static int64_t max2(const int64_t *a, unsigned argc)
+{
+  int64_t r = a[0];
+  for (unsigned i = 1; i < argc; ++i)
+    r = max(r, a[i]);
+  return r;
+}
+
+TEST_CASE("static_grammar_" "lex", "[static_grammar]" )
+{
+  const char s[] = " 2**3 ^(max,maxx) x $";
+  auto e = s + sizeof s - 1;
+  auto b = s;
+  vector<pair<string, unsigned> > v;
+  for (;;) {
+    auto r = Arithmetic::lex(b, e);
+    if (r.id == EPSILON || r.id == INVALID) {
+      v.emplace_back(string(r.p.first, r.p.second), r.id);
+      break;
+    }
+    v.emplace_back(string(r.p.first, r.p.second), r.id);
+    b = r.p.second;
+  }
+  vector<pair<string, unsigned> > w = {
+    {"2", OPERAND}, {"**", POWER}, {"3", OPERAND}, {"^", POWER},
+    {"(", LEFT_PAREN}, {"max", FUNCTION}, {",", COMMA}, {"maxx", FUNCTION},
+    {")", RIGHT_PAREN}, {"x", FUNCTION}, {"$", INVALID}
+  };
+  CHECK(v == w);
+  CHECK(Arithmetic::lex(e, e).id == EPSILON);
+
+  auto f = [](const char *s) {
+    auto op = Arithmetic::function(make_pair(s, s + strlen(s)));
+    return op ? int(op->id) : -1;
+  };
+  CHECK(f("max") == 20);
+  CHECK(f("maxx") == 21);
+  CHECK(f("ma") == -1);
+  CHECK(f("maxxx") == -1);
+}
+
+TEST_CASE("static_grammar_" "same as runtime grammar", "[static_grammar]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.function_table().insert("max", 20);
+  p.function_table().insert("maxx", 21);
+  p.symbol_table().insert("x");
+  Static_Parser<Arithmetic> q;
+  q.symbol_table().insert("x");
+
+  Evaluator<int64_t> ev;
+  ev.insert(20, Evaluator<int64_t>::VARIADIC, max2);
+  ev.insert(21, Evaluator<int64_t>::VARIADIC, max2);
+  int64_t x = 7;
+  for (auto s : { "1 + 2 * 3", "2 ** 3 ^ 2", "-2 * --3 - 4 / 2",
+      "max(1, x * 2, maxx(3, 4)) - x", "((x))", "max()",
+      "-(x + 1) * -max(x, 2) - -x" }) {
+    INFO(s);
+    auto a = p.compile<int64_t>(s);
+    auto b = q.compile<int64_t>(s);
+    CHECK(a.code().size() == b.code().size());
+    CHECK(a.constants() == b.constants());
+    if (strcmp(s, "max()"))
+      CHECK(ev.run(a, &x) == ev.run(b, &x));
+  }
+  for (auto s : { "1 + y", "1 $ 2", "(1 + 2", "1 + 2)", "max(1," }) {
+    INFO(s);
+    Program<int64_t> a, b;
+    auto e = p.try_compile(s, s + strlen(s), a);
+    auto f = q.try_compile(s, s + strlen(s), b);
+    CHECK(e.code != ERR_NONE);
+    CHECK(e.code == f.code);
+    CHECK(e.offset == f.offset);
+  }
+  CHECK_THROWS_AS(q.compile<int64_t>("1 + y"), std::range_error);
+
+  Stack<int64_t> o;
+  q.parse("2 * (3 + 4)", o, [&o](uint8_t id) {
+      auto b = o.top(); o.pop();
+      auto a = o.top(); o.pop();
+      o.push(id == MULT ? a * b : a + b);
+      });
+  CHECK(o.top() == 14);
+}
+
+TEST_CASE("static_grammar_" "arity", "[static_grammar]" )
+{
+  using G = Static_Grammar<Default_Arithmetic, Functions<
+    Static_Function_Arity<20, 1, Function_Table::VARIADIC, 'm', 'a', 'x'>,
+    Static_Function_Arity<21, 0, 0, 'p', 'i'>
+    > >;
+  Static_Parser<G> q;
+  Stack<int64_t> o;
+  unsigned argc = 0;
+  auto f = [&o, &argc](uint8_t, unsigned n) {
+    argc = n;
+    for (unsigned i = 0; i < n; ++i)
+      o.pop();
+    o.push(0);
+  };
+  CHECK(!q.try_parse("max(1, 2, 3)", "max(1, 2, 3)" + 12, o, f));
+  CHECK(argc == 3);
+  const char *s = "1 + max()";
+  auto e = q.try_parse(s, s + strlen(s), o, f);
+  CHECK(e.code == ERR_ARITY);
+  CHECK(e.offset == 4);
+  CHECK_THROWS_AS(q.compile<int64_t>("pi(1)"), std::invalid_argument);
+}
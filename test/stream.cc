@@ -0,0 +1,90 @@
+// 2016, Georg Sauthoff <mail@georg.so>
+
+#include <catch/catch.hpp>
+
+#include <syard/stream.hh>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace syard;
+
+static const char input[] = "1 + 2\n(3*4);;  \n 5^6;\r\n\n7 - 8\t;9";
+static const vector<string> expected = {
+  "1 + 2", "(3*4)", " 5^6", "7 - 8\t", "9"
+};
+
+TEST_CASE("stream_" "chunks", "[stream]" )
+{
+  size_t n = sizeof input - 1;
+  // i.e. every chunk boundary
+  for (size_t k = 1; k <= n; ++k) {
+    Expression_Splitter s;
+    vector<string> v;
+    auto f = [&v](const char *b, const char *e) { v.emplace_back(b, e); };
+    for (size_t i = 0; i < n; i += k)
+      s.feed(input + i, input + min(n, i + k), f);
+    s.finish(f);
+    CHECK(v == expected);
+    CHECK(s.bytes() == n);
+    CHECK(s.expressions() == 5);
+  }
+}
+
+TEST_CASE("stream_" "in place", "[stream]" )
+{
+  Expression_Splitter s;
+  vector<const char*> v;
+  auto f = [&v](const char *b, const char *) { v.push_back(b); };
+  s.feed(input, input + sizeof input - 1, f);
+  CHECK(v.size() == 4);
+  CHECK(v[1] == input + 6);
+  s.finish(f);
+  CHECK(v.size() == 5);
+}
+
+TEST_CASE("stream_" "reader", "[stream]" )
+{
+  size_t pos = 0;
+  vector<string> v;
+  split([&pos](char *buf, size_t n) {
+      n = min(n, sizeof input - 1 - pos);
+      memcpy(buf, input + pos, n);
+      pos += n;
+      return n;
+      },
+      [&v](const char *b, const char *e) { v.emplace_back(b, e); }, 3);
+  CHECK(v == expected);
+}
+
+TEST_CASE("stream_" "mmap", "[stream]" )
+{
+  char name[] = "/tmp/syard_stream_XXXXXX";
+  int fd = mkstemp(name);
+  REQUIRE(fd != -1);
+  REQUIRE(write(fd, input, sizeof input - 1) == sizeof input - 1);
+  close(fd);
+  {
+    Mapped_File m(name);
+    CHECK(m.size() == sizeof input - 1);
+    vector<string> v;
+    split(m, [&v](const char *b, const char *e) { v.emplace_back(b, e); });
+    CHECK(v == expected);
+  }
+  truncate(name, 0);
+  {
+    Mapped_File m(name);
+    CHECK(m.size() == 0);
+    size_t n = 0;
+    split(m, [&n](const char *, const char *) { ++n; });
+    CHECK(n == 0);
+  }
+  unlink(name);
+  CHECK_THROWS_AS(Mapped_File(name), std::system_error);
+}
@@ -3,7 +3,10 @@
 #include <catch/catch.hpp>
 
 #include <syard/syard.hh>
+#include <syard/program.hh>
 #include <string>
+#include <thread>
+#include <vector>
 #include <math.h>
 #include <assert.h>
 #include <iostream>
@@ -282,3 +285,407 @@ TEST_CASE("syard_" "throws2", "[syard][parse]" )
       }), std::underflow_error);
 }
 
+TEST_CASE("syard_" "try parse", "[syard][parse]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.function_table().insert("max", 20);
+  p.symbol_table().insert("x");
+  Stack<int64_t> o;
+  unsigned n = 0;
+  auto f = [&n](uint8_t) { ++n; };
+  struct Case {
+    const char *inp;
+    Error_Code code;
+    size_t offset;
+    const char *token;
+  };
+  Case cases[] = {
+    { "(1+2"          , ERR_UNMATCHED_ELEMENT  , 4, ""    },
+    { "1+2)*3"        , ERR_UNMATCHED_PAREN    , 3, ")"   },
+    { "1, 2"          , ERR_UNMATCHED_PAREN    , 1, ","   },
+    { "1 + foo(2)"    , ERR_UNKNOWN_NAME       , 4, "foo" },
+    { "2 * x"         , ERR_VARIABLE           , 4, "x"   },
+    { "1 + 2..5"      , ERR_MALFORMED_NUMBER   , 4, "2..5"},
+    { "99999999999999999999", ERR_NUMBER_RANGE, 0,
+      "99999999999999999999" },
+    { "3 # 4"         , ERR_LEX                , 2, "#"   },
+    { "1 + * 2"       , ERR_MISSING_OPERAND    , 7, ""    },
+    { "+2"            , ERR_MISSING_OPERAND    , 2, ""    },
+    { "1*-+2"         , ERR_MISSING_OPERAND    , 3, "+"   },
+    { "max(1, ) * 2"  , ERR_MISSING_OPERAND    , 7, ")"   },
+    { "max(1, 2) + 3" , ERR_NONE               , 0, nullptr }
+  };
+  for (auto &c : cases) {
+    auto e = p.try_parse(c.inp, o, f);
+    CHECK(e.code == c.code);
+    if (c.token) {
+      CHECK(e.offset == c.offset);
+      CHECK(string(e.token.first, e.token.second) == c.token);
+    }
+  }
+  // i.e. try_parse() rejects what try_compile() rejects
+  for (auto s : { "1 + * 2", "+2", "1*-+2", "max(1, ) * 2" }) {
+    INFO(s);
+    Program<int64_t> prog;
+    auto a = p.try_parse(s, s + strlen(s), o, f);
+    auto b = p.try_compile(s, s + strlen(s), prog);
+    CHECK(a.code == b.code);
+    CHECK(a.offset == b.offset);
+  }
+  // i.e. the input has to yield exactly one value
+  for (auto s : { "1 2", "(1,2)", "1+(2,3)", "x(1)", "max(1)(2)", "-", "()",
+      "2 * (-)", "(-) 2", "max(1, -, 2)" }) {
+    INFO(s);
+    Program<int64_t> prog;
+    auto b = p.try_compile(s, s + strlen(s), prog);
+    CHECK(b.code == ERR_MISSING_OPERAND);
+    if (strcmp(s, "x(1)")) {
+      auto a = p.try_parse(s, s + strlen(s), o, f);
+      CHECK(a.code == b.code);
+      CHECK(a.offset == b.offset);
+    }
+  }
+  {
+    Program<int64_t> prog;
+    CHECK_FALSE(p.try_compile("  ", "  " + 2, prog));
+    CHECK(prog.empty());
+  }
+  // i.e. on error, the stack isn't cleaned up
+  o = Stack<int64_t>();
+  n = 0;
+  CHECK_FALSE(p.try_parse("max(1, 2) + 3", o, f));
+  CHECK(n == 2);
+  CHECK(o.size() == 3);
+
+  Parse_Error e = p.try_parse("1 + foo", o, f);
+  CHECK(e);
+  CHECK(e.message() == "unknown function/variable: foo");
+  CHECK_THROWS_AS(e.raise(), std::range_error);
+  CHECK_FALSE(Parse_Error());
+  CHECK(string(error_string(ERR_UNMATCHED_PAREN)) == "unmatched paren");
+}
+
+TEST_CASE("syard_" "typed operands", "[syard][parse]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  Stack<int64_t> o;
+  p.parse(" (1+2)*(2+3)*4^(2*3+4)+2 - -2", o, [&o](uint8_t id) {
+      assert(o.size() >= 2);
+      auto b = o.top(); o.pop();
+      auto a = o.top(); o.pop();
+      int64_t c = 0;
+      switch (id) {
+      case POWER: c = pow(a, b); break;
+      case MULT : c = a * b; break;
+      case PLUS : c = a + b; break;
+      case MINUS: c = a - b; break;
+      }
+      o.push(c);
+      });
+  CHECK(o.top() == 15728644);
+  CHECK(o.size() == 1);
+}
+
+TEST_CASE("syard_" "double operands", "[syard][parse]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  Stack<double> o;
+  p.parse("-.5*-3/2", o, [&o](uint8_t id) {
+      assert(o.size() >= 2);
+      auto b = o.top(); o.pop();
+      auto a = o.top(); o.pop();
+      double c = 0;
+      switch (id) {
+      case MULT: c = a * b; break;
+      case DIV : c = a / b; break;
+      }
+      o.push(c);
+      });
+  CHECK(o.top() == 0.75);
+  CHECK(o.size() == 1);
+}
+
+TEST_CASE("syard_" "longest match", "[syard][lex]" )
+{
+  Operator_Table t;
+  t.insert("<"  , 20, 5, true);
+  t.insert("<=" , 21, 5, true);
+  t.insert("<=>", 22, 5, true);
+  t.insert("\xe2\x89\xa4", 23, 5, true); // U+2264 less-than or equal to
+  t.insert("\xe2\x89\xa0", 24, 5, true); // U+2260 not equal to
+  t.insert("\xe2\x88\x92", 25, 5, true); // U+2212 minus sign
+
+  const char inp[] = "<=< <=> <==\xe2\x89\xa0\xe2\x89\xa4\xe2\x88\x92";
+  auto e = inp + sizeof(inp) - 1;
+  uint8_t ids[] = { 21, 20, 22, 21 };
+  auto r = t.lex(inp, e);
+  for (unsigned i = 0; i < 4; ++i) {
+    CHECK(r.id == ids[i]);
+    if (i < 3)
+      r = t.lex(r.p.second, e);
+  }
+  CHECK_THROWS_AS(t.lex(r.p.second, e), std::range_error);
+  r = t.lex(r.p.second + 1, e);
+  CHECK(r.id == 24);
+  CHECK(r.p.second - r.p.first == 3);
+  r = t.lex(r.p.second, e);
+  CHECK(r.id == 23);
+  r = t.lex(r.p.second, e);
+  CHECK(r.id == 25);
+  CHECK(r.p.second == e);
+
+  // a truncated multi-byte operator
+  r = t.lex(inp + 8, inp + 10);
+  CHECK(r.id == 21);
+  CHECK_THROWS_AS(t.lex(e - 2, e), std::range_error);
+}
+
+TEST_CASE("syard_" "function table", "[syard][function]" )
+{
+  Function_Table t;
+  vector<string> names;
+  for (unsigned i = 0; i < 200; ++i) {
+    string s;
+    for (unsigned j = i; ; j /= 26) {
+      s += char('a' + j % 26);
+      if (j < 26)
+        break;
+    }
+    names.push_back(s);
+    t.insert(s.c_str(), FIRST_ID + i % 200);
+  }
+  t.insert("a", 42); // already present
+  auto lookup = [&t](const string &s) {
+    return t.at(make_pair(s.data(), s.data() + s.size())); };
+  CHECK(!t.frozen());
+  CHECK(lookup("a")->id == FIRST_ID);
+  t.freeze();
+  CHECK(t.frozen());
+  for (unsigned i = 0; i < names.size(); ++i) {
+    REQUIRE(lookup(names[i]) != nullptr);
+    CHECK(lookup(names[i])->id == FIRST_ID + i);
+    CHECK(lookup(names[i])->function);
+  }
+  CHECK_THROWS_AS(lookup("zzzz"), std::range_error);
+  CHECK_THROWS_AS(lookup("toolongname"), std::range_error);
+  CHECK_THROWS_AS(lookup(""), std::range_error);
+
+  t.insert("sqrt", 7);
+  CHECK(!t.frozen());
+  CHECK(lookup("sqrt")->id == 7);
+  t.freeze();
+  CHECK(lookup("sqrt")->id == 7);
+  CHECK(lookup("a")->id == FIRST_ID);
+}
+
+TEST_CASE("syard_" "symbol table", "[syard][variable]" )
+{
+  Symbol_Table t;
+  CHECK(t.size() == 0);
+  vector<string> names;
+  for (unsigned i = 0; i < 1000; ++i)
+    names.push_back("v" + to_string(i));
+  for (unsigned i = 0; i < names.size(); ++i)
+    CHECK(t.insert(names[i].c_str()) == i);
+  CHECK(t.insert("v42") == 42);
+  CHECK(t.size() == 1000);
+  for (unsigned i = 0; i < names.size(); ++i) {
+    auto &s = names[i];
+    CHECK(t.find(make_pair(s.data(), s.data() + s.size())) == int(i));
+    CHECK(t.name(i) == s);
+  }
+  const char x[] = "v1000";
+  CHECK(t.find(make_pair(x, x + sizeof x - 1)) == -1);
+  CHECK(t.find(make_pair(x, x + 2)) == 1);
+  CHECK_THROWS_AS(t.name(1000), std::range_error);
+}
+
+TEST_CASE("syard_" "variables", "[syard][variable]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.function_table().insert("max", 20);
+  p.symbol_table().insert("price");
+  p.symbol_table().insert("qty");
+  auto &o = p.arg_stack();
+  vector<uint8_t> ids;
+  p.parse("price * -qty - 2", [&ids](uint8_t id) { ids.push_back(id); });
+  REQUIRE(o.size() == 3);
+  o.pop();
+  CHECK(o.top() == "qty");
+  o.pop();
+  CHECK(o.top() == "price");
+  o.pop();
+  CHECK(ids == vector<uint8_t>({ NEGATE, MULT, MINUS }));
+  CHECK_THROWS_AS(p.parse("price * fee", [](uint8_t) {}), std::range_error);
+  Stack<double> d;
+  CHECK_THROWS_AS(p.parse("price * 2", d, [](uint8_t) {}), std::range_error);
+}
+
+TEST_CASE("syard_" "insert during parse", "[syard][parse]" )
+{
+  Parser p;
+  auto &t = p.operator_table();
+  t.insert('+', 13, 9, true);
+  auto &o = p.arg_stack();
+  bool inserted = false;
+  p.parse("1+2+3*4", [&o, &t, &inserted](uint8_t id) {
+      if (!inserted) {
+        t.insert('*', 11, 10, true);
+        inserted = true;
+      }
+      o.push(to_string(id));
+      });
+  CHECK(inserted);
+
+  // i.e. the pending operators survive the table growing under them
+  p.operator_table().insert('-', 14, 9, true);
+  vector<uint8_t> ids;
+  unsigned k = 0;
+  Stack<int64_t> s;
+  p.parse("1-2*(3+4)-5+6", s, [&](uint8_t id) {
+      for (unsigned i = 0; i < 8; ++i)
+        t.insert(("@" + to_string(k++)).c_str(), 100, 1, true);
+      p.function_table().insert(("f" + to_string(k)).c_str(), 101);
+      ids.push_back(id);
+      });
+  CHECK(ids == vector<uint8_t>({ 13, 11, 14, 14, 13 }));
+}
+
+TEST_CASE("syard_" "shared grammar", "[syard][grammar]" )
+{
+  auto g = make_shared<Grammar>();
+  g->operator_table().insert_default_arithmetic();
+  g->function_table().insert("max", 20);
+  g->symbol_table().insert("x");
+  CHECK_THROWS_AS(Parser(g), std::invalid_argument);
+  g->freeze();
+  CHECK(g->frozen());
+
+  vector<thread> ts;
+  vector<int> ok(8);
+  for (unsigned i = 0; i < ok.size(); ++i)
+    ts.emplace_back([g, i, &ok] {
+        Parser p(g);
+        Stack<int64_t> o;
+        int n = 0;
+        for (unsigned j = 0; j < 1000; ++j) {
+          string s = to_string(i) + "*(" + to_string(j) + "+1)";
+          p.parse(s.c_str(), o, [&o](uint8_t id) {
+              auto b = o.top(); o.pop();
+              auto a = o.top(); o.pop();
+              o.push(id == MULT ? a * b : a + b);
+              });
+          n += o.top() == int64_t(i * (j + 1));
+          o.pop();
+        }
+        ok[i] = n;
+        });
+  for (auto &t : ts)
+    t.join();
+  for (auto n : ok)
+    CHECK(n == 1000);
+
+  Parser p(g);
+  CHECK_THROWS_AS(p.operator_table(), std::logic_error);
+  CHECK_THROWS_AS(p.symbol_table(), std::logic_error);
+  CHECK(p.grammar().symbol_table().size() == 1);
+  CHECK(p.compile<double>("max(x, 2)").variables() == 1);
+}
+
+TEST_CASE("syard_" "stats", "[syard][stats]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.function_table().insert("max", 20);
+  p.symbol_table().insert("x");
+  Stack<string> s;
+  p.parse("max(1, 2 * 3) + x", s, [&s](uint8_t) {});
+  auto &t = p.stats();
+#ifdef SYARD_STATS
+  CHECK(t.parses == 1);
+  CHECK(t.tokens[OPERAND] == 3);
+  CHECK(t.tokens[VARIABLE] == 1);
+  CHECK(t.tokens[FUNCTION] == 1);
+  CHECK(t.tokens[OPERATOR] == 2);
+  CHECK(t.tokens[LEFT_PAREN] == 1);
+  CHECK(t.tokens[RIGHT_PAREN] == 1);
+  CHECK(t.tokens[COMMA] == 1);
+  CHECK(t.tokens[EPSILON] == 1);
+  CHECK(t.function_lookups == 2);
+  CHECK(t.function_misses == 1);
+  CHECK(t.max_arg_stack == 3);
+  CHECK(t.max_op_stack == 3);
+  CHECK(t.lex_probes >= 5);
+  CHECK(p.try_parse("1 $ 2", s, [](uint8_t) {}).code == ERR_LEX);
+  CHECK(t.parses == 2);
+  CHECK(t.tokens[INVALID] == 1);
+#else
+  CHECK(t.parses == 0);
+  CHECK(t.lex_probes == 0);
+  CHECK(t.tokens[OPERAND] == 0);
+#endif
+  p.reset_stats();
+  CHECK(p.stats().parses == 0);
+}
+
+TEST_CASE("syard_" "arity", "[syard][parse]" )
+{
+  Parser p;
+  p.operator_table().insert_default_arithmetic();
+  p.function_table().insert("max", 20, 1, Function_Table::VARIADIC);
+  p.function_table().insert("sqrt", 21, 1, 1);
+  p.function_table().insert("pi", 22, 0, 0);
+  p.function_table().insert("any", 23);
+  CHECK_THROWS_AS(p.function_table().insert("bad", 24, 2, 1),
+      std::invalid_argument);
+  Stack<int64_t> o;
+  vector<pair<uint8_t, unsigned> > calls;
+  auto f = [&o, &calls](uint8_t id, unsigned argc) {
+    calls.emplace_back(id, argc);
+    for (unsigned i = 0; i < argc; ++i)
+      o.pop();
+    o.push(0);
+  };
+  CHECK(!p.try_parse("max(1, 2, 3, 4) + sqrt(9) * pi() - any()", o, f));
+  REQUIRE(calls.size() == 7);
+  CHECK(calls[0] == make_pair(uint8_t(20), 4u));
+  CHECK(calls[1] == make_pair(uint8_t(21), 1u));
+  CHECK(calls[2] == make_pair(uint8_t(22), 0u));
+  CHECK(calls[3] == make_pair(uint8_t(MULT), 2u));
+  CHECK(calls[4] == make_pair(uint8_t(PLUS), 2u));
+  CHECK(calls[5] == make_pair(uint8_t(23), 0u));
+  CHECK(calls[6] == make_pair(uint8_t(MINUS), 2u));
+
+  struct Case {
+    const char *inp;
+    size_t offset;
+    const char *token;
+  };
+  Case cases[] = {
+    { "1 + max()"       , 4, "max"  },
+    { "sqrt(1, 2)"      , 0, "sqrt" },
+    { "2 * pi(3)"       , 4, "pi"   },
+    { "max(sqrt(), 1)"  , 4, "sqrt" }
+  };
+  for (auto &c : cases) {
+    o = Stack<int64_t>();
+    auto e = p.try_parse(c.inp, o, f);
+    CHECK(e.code == ERR_ARITY);
+    CHECK(e.offset == c.offset);
+    CHECK(string(e.token.first, e.token.second) == c.token);
+  }
+  CHECK_THROWS_AS(p.compile<int64_t>("sqrt(1, 2)"), std::invalid_argument);
+  Program<int64_t> prog;
+  CHECK(p.try_compile("max()", "max()" + 5, prog).code == ERR_ARITY);
+
+  // i.e. the argument counts are recorded in the program
+  prog = p.compile<int64_t>("max(1, 2, 3)");
+  o = Stack<int64_t>();
+  unsigned argc = 0;
+  prog.run(o, [&argc](uint8_t, unsigned n) { argc = n; });
+  CHECK(argc == 3);
+}